@@ -0,0 +1,203 @@
+#ifndef INCLUDED_BENCH_BENCH_HH
+#define INCLUDED_BENCH_BENCH_HH
+
+#include "perf_counters.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Minimal self-contained benchmark harness. A benchmark is a function that performs a batch of operations;
+// the harness calibrates how many batches make up a sample, takes several samples and reports the median
+// time per operation. With --perf, one more sample is taken with hardware performance counters, which are
+// reported per operation as well. Results are written as JSON so runs can be compared across releases.
+
+namespace bench {
+  // Keeps the compiler from optimizing away a computed value.
+  template<typename T>
+  inline void do_not_optimize(T const &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+  }
+
+  inline void clobber_memory() {
+    asm volatile("" : : : "memory");
+  }
+
+  struct options {
+    std::string filter;
+    double      min_time    = 0.1; // seconds per sample
+    int         repetitions = 5;
+    bool        perf        = false;
+
+    // Accepts --filter=<substring>, --min-time=<seconds>, --repetitions=<n> and --perf. Unknown arguments
+    // are left to the caller.
+    static options parse(int argc, char *argv[], std::vector<std::string> *rest = nullptr) {
+      options opts;
+
+      for(int i = 1; i < argc; ++i) {
+        std::string_view arg(argv[i]);
+
+        if(arg.starts_with("--filter=")) {
+          opts.filter = arg.substr(9);
+        } else if(arg.starts_with("--min-time=")) {
+          opts.min_time = std::atof(argv[i] + 11);
+        } else if(arg.starts_with("--repetitions=")) {
+          opts.repetitions = std::max(1, std::atoi(argv[i] + 14));
+        } else if(arg == "--perf") {
+          opts.perf = true;
+        } else if(rest) {
+          rest->emplace_back(arg);
+        }
+      }
+
+      return opts;
+    }
+  };
+
+  struct result {
+    std::string name;
+    std::size_t batches;        // per sample
+    std::size_t ops_per_batch;
+    double      ns_per_op;      // median over samples
+    double      ns_per_op_min;
+    double      ns_per_op_max;
+
+    perf_counters::sample counters; // per operation, empty without --perf
+  };
+
+  class runner {
+  public:
+    explicit runner(options opts) : opts_(std::move(opts)) {
+      if(opts_.perf) {
+        perf_ = std::make_unique<perf_counters>();
+
+        if(!perf_->available()) {
+          std::cerr << "hardware performance counters are not available, continuing without them\n";
+        }
+      }
+    }
+
+    // Runs batch() repeatedly; every call performs ops_per_batch operations.
+    template<typename F>
+    void run(std::string const &name, std::size_t ops_per_batch, F &&batch) {
+      if(!opts_.filter.empty() && name.find(opts_.filter) == std::string::npos) {
+        return;
+      }
+
+      using clock = std::chrono::steady_clock;
+
+      auto time_batches = [&](std::size_t n) {
+        auto start = clock::now();
+        for(std::size_t i = 0; i < n; ++i) {
+          batch();
+        }
+        return std::chrono::duration<double>(clock::now() - start).count();
+      };
+
+      // calibrate
+      std::size_t batches = 1;
+      for(double t = time_batches(batches); t < opts_.min_time && batches < (std::size_t(1) << 40); t = time_batches(batches)) {
+        batches = t > 0 ? std::max(batches * 2, static_cast<std::size_t>(batches * opts_.min_time / t * 1.2)) : batches * 10;
+      }
+
+      std::vector<double> samples;
+      for(int r = 0; r < opts_.repetitions; ++r) {
+        samples.push_back(time_batches(batches) * 1e9 / static_cast<double>(batches * ops_per_batch));
+      }
+
+      std::sort(samples.begin(), samples.end());
+      results_.push_back({ name, batches, ops_per_batch, samples[samples.size() / 2], samples.front(), samples.back(), { } });
+
+      if(perf_ && perf_->available()) {
+        perf_->start();
+        time_batches(batches);
+        results_.back().counters = perf_->stop(static_cast<double>(batches * ops_per_batch));
+      }
+
+      std::cerr << std::left << std::setw(48) << name << ' ' << std::right << std::fixed << std::setprecision(3)
+                << std::setw(12) << results_.back().ns_per_op << " ns/op\n";
+    }
+
+    std::vector<result> const &results() const noexcept { return results_; }
+    options const &opts() const noexcept { return opts_; }
+
+  private:
+    options                        opts_;
+    std::vector<result>            results_;
+    std::unique_ptr<perf_counters> perf_;
+  };
+
+  // p-quantile (0 <= p <= 1) of samples, which is sorted in the process.
+  template<typename T>
+  T percentile(std::vector<T> &samples, double p) {
+    if(samples.empty()) {
+      return T();
+    }
+
+    std::size_t n = std::min(samples.size() - 1, static_cast<std::size_t>(p * static_cast<double>(samples.size())));
+    std::nth_element(samples.begin(), samples.begin() + n, samples.end());
+    return samples[n];
+  }
+
+  inline std::string json_escape(std::string_view s) {
+    std::string out;
+
+    for(char c : s) {
+      switch(c) {
+      case '"' : out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\n': out += "\\n" ; break;
+      default  : out += c     ; break;
+      }
+    }
+
+    return out;
+  }
+
+  inline void write_json_counters(std::ostream &out, perf_counters::sample const &counters) {
+    out << '{';
+
+    for(std::size_t i = 0; i < counters.values.size(); ++i) {
+      out << (i == 0 ? " \"" : ", \"") << json_escape(counters.values[i].first) << "\": " << counters.values[i].second;
+    }
+
+    out << " }";
+  }
+
+  inline void write_json(std::ostream &out, std::string_view suite, std::vector<result> const &results) {
+    out << "{\n  \"suite\": \"" << json_escape(suite) << "\",\n  \"results\": [";
+
+    for(std::size_t i = 0; i < results.size(); ++i) {
+      result const &r = results[i];
+
+      out << (i == 0 ? "\n" : ",\n")
+          << "    { \"name\": \"" << json_escape(r.name) << "\""
+          << ", \"batches\": "       << r.batches
+          << ", \"ops_per_batch\": " << r.ops_per_batch
+          << std::setprecision(4) << std::fixed
+          << ", \"ns_per_op\": "     << r.ns_per_op
+          << ", \"ns_per_op_min\": " << r.ns_per_op_min
+          << ", \"ns_per_op_max\": " << r.ns_per_op_max;
+
+      if(!r.counters.values.empty()) {
+        out << ", \"counters_per_op\": ";
+        write_json_counters(out, r.counters);
+      }
+
+      out << " }";
+    }
+
+    out << "\n  ]\n}\n";
+  }
+}
+
+#endif
@@ -0,0 +1,252 @@
+// Microbenchmarks for inplace::factory against std::unique_ptr<Base> and std::variant.
+//
+// Every benchmark works on a batch of objects of mixed types and reports the time per object. Results go to
+// stdout as JSON, a human-readable summary to stderr.
+
+#include "bench.hh"
+
+#include <inplace/factory.hh>
+#include <inplace/factory_vector.hh>
+
+#include <array>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace {
+  struct shape {
+    virtual ~shape() { }
+    virtual int val() const = 0;
+    virtual std::unique_ptr<shape> clone() const = 0;
+  };
+
+  template<std::size_t N>
+  struct payload final : shape {
+    explicit payload(int x) { data[0] = x; }
+
+    int val() const override { return data[0]; }
+    std::unique_ptr<shape> clone() const override { return std::make_unique<payload>(*this); }
+
+    std::array<int, N> data = { };
+  };
+
+  using small  = payload< 2>;
+  using medium = payload< 8>;
+  using large  = payload<32>;
+}
+
+// payloads hold nothing but plain data, so moving their bytes is fine.
+template<std::size_t N> struct inplace::is_trivially_relocatable<payload<N>> : std::true_type { };
+
+namespace {
+
+  struct factory_impl {
+    static constexpr char const *name = "factory";
+    using value = inplace::factory<shape, small, medium, large>;
+
+    template<typename T> static void emplace(value &v, int x) { v.template construct<T>(x); }
+    static void clear(value       &v) { v.clear(); }
+    static int  call (value const &v) { return v->val(); }
+    static void copy (value &to, value const &from) { to = from; }
+  };
+
+  // same as factory_impl, but calls through visit() instead of the vtable
+  struct factory_visit_impl : factory_impl {
+    static constexpr char const *name = "factory_visit";
+
+    static int call(value const &v) { return v.visit([](auto const &obj) { return obj.val(); }); }
+  };
+
+  struct unique_ptr_impl {
+    static constexpr char const *name = "unique_ptr";
+    using value = std::unique_ptr<shape>;
+
+    template<typename T> static void emplace(value &v, int x) { v = std::make_unique<T>(x); }
+    static void clear(value       &v) { v.reset(); }
+    static int  call (value const &v) { return v->val(); }
+    static void copy (value &to, value const &from) { to = from->clone(); }
+  };
+
+  struct variant_impl {
+    static constexpr char const *name = "variant";
+    using value = std::variant<std::monostate, small, medium, large>;
+
+    template<typename T> static void emplace(value &v, int x) { v.template emplace<T>(x); }
+    static void clear(value &v) { v.template emplace<std::monostate>(); }
+    static void copy (value &to, value const &from) { to = from; }
+
+    static int call(value const &v) {
+      return std::visit([](auto const &obj) {
+          if constexpr(std::is_same_v<std::remove_cvref_t<decltype(obj)>, std::monostate>) {
+            return 0;
+          } else {
+            return obj.val();
+          }
+        }, v);
+    }
+  };
+
+  constexpr std::size_t batch_size = 1024;
+
+  template<typename impl>
+  void emplace_kind(typename impl::value &v, int kind, int x) {
+    switch(kind) {
+    case 0 : impl::template emplace<small >(v, x); break;
+    case 1 : impl::template emplace<medium>(v, x); break;
+    default: impl::template emplace<large >(v, x); break;
+    }
+  }
+
+  // A mixed, but reproducible sequence of types.
+  std::vector<int> make_kinds(unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> dist(0, 2);
+    std::vector<int> kinds(batch_size);
+
+    for(int &k : kinds) {
+      k = dist(rng);
+    }
+
+    return kinds;
+  }
+
+  template<typename impl>
+  std::vector<typename impl::value> make_batch(std::vector<int> const &kinds) {
+    std::vector<typename impl::value> v(kinds.size());
+
+    for(std::size_t i = 0; i < v.size(); ++i) {
+      emplace_kind<impl>(v[i], kinds[i], static_cast<int>(i));
+    }
+
+    return v;
+  }
+
+  template<typename impl>
+  void run_suite(bench::runner &runner) {
+    using value = typename impl::value;
+
+    std::string const prefix = std::string(impl::name) + "/";
+    std::vector<int> const kinds  = make_kinds(1);
+    std::vector<int> const kinds2 = make_kinds(2);
+
+    {
+      std::vector<value> v = make_batch<impl>(kinds);
+
+      runner.run(prefix + "construct", batch_size, [&] {
+          for(std::size_t i = 0; i < batch_size; ++i) {
+            emplace_kind<impl>(v[i], kinds[i], static_cast<int>(i));
+          }
+          bench::clobber_memory();
+        });
+    }
+
+    {
+      value v;
+
+      runner.run(prefix + "construct_clear", batch_size, [&] {
+          for(std::size_t i = 0; i < batch_size; ++i) {
+            emplace_kind<impl>(v, kinds[i], static_cast<int>(i));
+            bench::do_not_optimize(v);
+            impl::clear(v);
+          }
+        });
+    }
+
+    {
+      std::vector<value> const src = make_batch<impl>(kinds);
+      std::vector<value>       dst(batch_size);
+
+      runner.run(prefix + "copy", batch_size, [&] {
+          for(std::size_t i = 0; i < batch_size; ++i) {
+            impl::copy(dst[i], src[i]);
+          }
+          bench::clobber_memory();
+        });
+    }
+
+    {
+      std::vector<value> a = make_batch<impl>(kinds);
+      std::vector<value> b(batch_size);
+
+      // two moves per element: there and back again
+      runner.run(prefix + "move", 2 * batch_size, [&] {
+          for(std::size_t i = 0; i < batch_size; ++i) {
+            b[i] = std::move(a[i]);
+          }
+          bench::clobber_memory();
+          for(std::size_t i = 0; i < batch_size; ++i) {
+            a[i] = std::move(b[i]);
+          }
+          bench::clobber_memory();
+        });
+    }
+
+    {
+      // assignment between different types: alternates dst between the types of src and src2
+      std::vector<value> const src  = make_batch<impl>(kinds);
+      std::vector<value> const src2 = make_batch<impl>(kinds2);
+      std::vector<value>       dst  = make_batch<impl>(kinds);
+
+      runner.run(prefix + "assign_mixed", 2 * batch_size, [&] {
+          for(std::size_t i = 0; i < batch_size; ++i) {
+            impl::copy(dst[i], src2[i]);
+            bench::do_not_optimize(dst[i]);
+            impl::copy(dst[i], src[i]);
+          }
+          bench::clobber_memory();
+        });
+    }
+
+    runner.run(prefix + "vector_growth", batch_size, [&] {
+        std::vector<value> v;
+
+        for(std::size_t i = 0; i < batch_size; ++i) {
+          emplace_kind<impl>(v.emplace_back(), kinds[i], static_cast<int>(i));
+        }
+
+        bench::do_not_optimize(v.data());
+      });
+
+    if constexpr(std::is_same_v<impl, factory_impl>) {
+      // same as vector_growth, but reallocation is a memcpy
+      runner.run(prefix + "factory_vector_growth", batch_size, [&] {
+          inplace::factory_vector<value> v;
+
+          for(std::size_t i = 0; i < batch_size; ++i) {
+            emplace_kind<impl>(v.push_back(value()), kinds[i], static_cast<int>(i));
+          }
+
+          bench::do_not_optimize(v.data());
+        });
+    }
+
+    {
+      std::vector<value> const v = make_batch<impl>(kinds);
+
+      runner.run(prefix + "call", batch_size, [&] {
+          int sum = 0;
+
+          for(value const &x : v) {
+            sum += impl::call(x);
+          }
+
+          bench::do_not_optimize(sum);
+        });
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  bench::runner runner(bench::options::parse(argc, argv));
+
+  run_suite<factory_impl      >(runner);
+  run_suite<factory_visit_impl>(runner);
+  run_suite<unique_ptr_impl   >(runner);
+  run_suite<variant_impl      >(runner);
+
+  bench::write_json(std::cout, "factory_bench", runner.results());
+}
@@ -0,0 +1,130 @@
+#ifndef INCLUDED_BENCH_PERF_COUNTERS_HH
+#define INCLUDED_BENCH_PERF_COUNTERS_HH
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware performance counters around a benchmarked section, read through Linux perf_event_open.
+//
+// The counters are opened as one group so they are scheduled together; if the kernel multiplexes them, the
+// values are scaled by the fraction of time they ran. Counters that cannot be opened (no permission,
+// unsupported by the CPU, not on Linux, inside a container without perf access) are silently left out, so
+// benchmarks still run without them. They count user-space events of the calling thread only.
+
+namespace bench {
+  class perf_counters {
+  public:
+    struct sample {
+      std::vector<std::pair<std::string, double>> values;
+    };
+
+    perf_counters() {
+#ifdef __linux__
+      open_counter("cycles"        , PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+      open_counter("instructions"  , PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+      open_counter("branch_misses" , PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+      open_counter("l1d_read_misses", PERF_TYPE_HW_CACHE,
+                   PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+      open_counter("llc_misses"    , PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+#endif
+    }
+
+    ~perf_counters() {
+#ifdef __linux__
+      for(counter const &c : counters_) {
+        close(c.fd);
+      }
+#endif
+    }
+
+    perf_counters(perf_counters const &) = delete;
+    perf_counters &operator=(perf_counters const &) = delete;
+
+    bool available() const noexcept { return !counters_.empty(); }
+
+    void start() noexcept {
+#ifdef __linux__
+      if(available()) {
+        ioctl(leader(), PERF_EVENT_IOC_RESET , PERF_IOC_FLAG_GROUP);
+        ioctl(leader(), PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+      }
+#endif
+    }
+
+    // Stops counting and returns the counts since start(), divided by ops.
+    sample stop(double ops = 1.0) noexcept {
+      sample result;
+
+#ifdef __linux__
+      if(!available()) {
+        return result;
+      }
+
+      ioctl(leader(), PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+      // PERF_FORMAT_GROUP layout: nr, time_enabled, time_running, value[nr]
+      std::array<std::uint64_t, 3 + max_counters> buf = { };
+      if(read(leader(), buf.data(), sizeof buf) < static_cast<ssize_t>(3 * sizeof(std::uint64_t))) {
+        return result;
+      }
+
+      double scale = buf[2] > 0 ? static_cast<double>(buf[1]) / static_cast<double>(buf[2]) : 1.0;
+
+      for(std::size_t i = 0; i < counters_.size() && i < buf[0]; ++i) {
+        result.values.emplace_back(counters_[i].name, static_cast<double>(buf[3 + i]) * scale / ops);
+      }
+#else
+      (void) ops;
+#endif
+
+      return result;
+    }
+
+  private:
+    static constexpr std::size_t max_counters = 8;
+
+    struct counter {
+      std::string name;
+      int         fd;
+    };
+
+#ifdef __linux__
+    int leader() const noexcept { return counters_.front().fd; }
+
+    void open_counter(char const *name, std::uint32_t type, std::uint64_t config) {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof attr);
+
+      attr.size           = sizeof attr;
+      attr.type           = type;
+      attr.config         = config;
+      attr.disabled       = counters_.empty() ? 1 : 0; // the group is enabled through its leader
+      attr.exclude_kernel = 1;
+      attr.exclude_hv     = 1;
+      attr.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+      int group = counters_.empty() ? -1 : leader();
+      int fd    = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+
+      if(fd >= 0) {
+        counters_.push_back({ name, fd });
+      }
+    }
+#endif
+
+    std::vector<counter> counters_;
+  };
+}
+
+#endif
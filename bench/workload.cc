@@ -0,0 +1,440 @@
+// End-to-end workload benchmark modeled on polymorphic message processing.
+//
+// Every worker thread owns a set of message slots and replays a pregenerated stream of operations on them:
+//
+//   construct: a new message of a randomly chosen type goes into a slot. Type frequencies follow a Zipf
+//              distribution over types of increasing size, so small messages dominate.
+//   reassign:  v[a] = v[b] = v[c], like the chained assignments in examples/example.cc.
+//   process:   a virtual call on the message in a slot.
+//
+// The benchmark reports throughput and p50/p99/p99.9 latency per operation kind for every implementation
+// and thread count, as JSON on stdout. The workers set up their slots first and then start the replay
+// together; throughput is taken over the replay alone. Latency is sampled, so the clock reads do not
+// dominate the cheap operations. Options:
+//
+//   --ops=<n>         operations per thread (default 1000000)
+//   --slots=<n>       live messages per thread (default 4096)
+//   --skew=<s>        Zipf exponent of the type distribution (default 1.0)
+//   --reassign=<f>    fraction of reassign operations (default 0.1)
+//   --process=<f>     fraction of process operations (default 0.5)
+//   --threads=<list>  comma-separated thread counts (default 1,2,4)
+//   --impl=<name>     factory, unique_ptr, variant or all (default all)
+//   --sample=<n>      time every n-th operation for the latency percentiles (default 16)
+//   --perf            read hardware performance counters in every worker and report them per operation.
+//                     These cover the whole replay, including the clock reads for the latency samples.
+
+#include "bench.hh"
+
+#include <inplace/factory.hh>
+
+#include <algorithm>
+#include <array>
+#include <barrier>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <variant>
+#include <vector>
+
+namespace {
+  struct message {
+    virtual ~message() { }
+    virtual std::uint64_t process() const = 0;
+    virtual std::unique_ptr<message> clone() const = 0;
+  };
+
+  template<std::size_t Size>
+  struct sized_message final : message {
+    explicit sized_message(std::uint64_t seq) {
+      for(std::size_t i = 0; i < words.size(); ++i) {
+        words[i] = seq + i;
+      }
+    }
+
+    std::uint64_t process() const override {
+      std::uint64_t sum = 0;
+      for(std::uint64_t w : words) {
+        sum += w;
+      }
+      return sum;
+    }
+
+    std::unique_ptr<message> clone() const override { return std::make_unique<sized_message>(*this); }
+
+    std::array<std::uint64_t, (Size - sizeof(void *)) / sizeof(std::uint64_t)> words;
+  };
+
+  // ordered by frequency rank: the first type is the most common one.
+  using msg0 = sized_message< 16>;
+  using msg1 = sized_message< 24>;
+  using msg2 = sized_message< 48>;
+  using msg3 = sized_message< 64>;
+  using msg4 = sized_message<128>;
+  using msg5 = sized_message<256>;
+
+  constexpr int type_count = 6;
+
+  struct factory_impl {
+    static constexpr char const *name = "factory";
+    using value = inplace::factory<message, msg0, msg1, msg2, msg3, msg4, msg5>;
+
+    template<typename T> static void emplace(value &v, std::uint64_t seq) { v.template construct<T>(seq); }
+    static void          copy   (value &to, value const &from) { to = from; }
+    static std::uint64_t process(value const &v)               { return v->process(); }
+  };
+
+  struct unique_ptr_impl {
+    static constexpr char const *name = "unique_ptr";
+    using value = std::unique_ptr<message>;
+
+    template<typename T> static void emplace(value &v, std::uint64_t seq) { v = std::make_unique<T>(seq); }
+    static void          copy   (value &to, value const &from) { to = from->clone(); }
+    static std::uint64_t process(value const &v)               { return v->process(); }
+  };
+
+  struct variant_impl {
+    static constexpr char const *name = "variant";
+    using value = std::variant<std::monostate, msg0, msg1, msg2, msg3, msg4, msg5>;
+
+    template<typename T> static void emplace(value &v, std::uint64_t seq) { v.template emplace<T>(seq); }
+    static void          copy   (value &to, value const &from) { to = from; }
+    static std::uint64_t process(value const &v) {
+      return std::visit([](auto const &m) -> std::uint64_t {
+          if constexpr(std::is_same_v<std::remove_cvref_t<decltype(m)>, std::monostate>) {
+            return 0;
+          } else {
+            return m.process();
+          }
+        }, v);
+    }
+  };
+
+  enum op_kind : std::uint8_t {
+    OP_CONSTRUCT,
+    OP_REASSIGN,
+    OP_PROCESS,
+    OP_KIND_COUNT
+  };
+
+  constexpr char const *op_names[] = { "construct", "reassign", "process" };
+
+  struct op {
+    op_kind       kind;
+    std::uint8_t  type;
+    std::uint32_t a, b, c;
+  };
+
+  struct config {
+    std::size_t      ops      = 1000000;
+    std::size_t      slots    = 4096;
+    double           skew     = 1.0;
+    double           reassign = 0.1;
+    double           process  = 0.5;
+    std::vector<int> threads  = { 1, 2, 4 };
+    std::string      impl     = "all";
+    std::size_t      sample   = 16;
+    bool             perf     = false;
+  };
+
+  config parse_config(std::vector<std::string> const &args) {
+    config cfg;
+
+    for(std::string const &arg : args) {
+      auto value = [&](std::string_view key) -> char const * {
+        return arg.starts_with(key) ? arg.c_str() + key.size() : nullptr;
+      };
+
+      if(char const *v = value("--ops=")) {
+        cfg.ops = std::strtoull(v, nullptr, 10);
+      } else if(char const *v = value("--slots=")) {
+        cfg.slots = std::max<std::size_t>(1, std::strtoull(v, nullptr, 10));
+      } else if(char const *v = value("--skew=")) {
+        cfg.skew = std::atof(v);
+      } else if(char const *v = value("--reassign=")) {
+        cfg.reassign = std::atof(v);
+      } else if(char const *v = value("--process=")) {
+        cfg.process = std::atof(v);
+      } else if(char const *v = value("--sample=")) {
+        cfg.sample = std::max<std::size_t>(1, std::strtoull(v, nullptr, 10));
+      } else if(arg == "--perf") {
+        cfg.perf = true;
+      } else if(char const *v = value("--impl=")) {
+        cfg.impl = v;
+      } else if(char const *v = value("--threads=")) {
+        cfg.threads.clear();
+
+        std::istringstream in(v);
+        for(std::string n; std::getline(in, n, ','); ) {
+          cfg.threads.push_back(std::max(1, std::atoi(n.c_str())));
+        }
+      } else {
+        std::cerr << "unknown argument: " << arg << '\n';
+        std::exit(1);
+      }
+    }
+
+    return cfg;
+  }
+
+  std::vector<op> make_stream(config const &cfg, unsigned seed) {
+    std::mt19937_64 rng(seed);
+
+    std::vector<double> weights;
+    for(int i = 0; i < type_count; ++i) {
+      weights.push_back(1.0 / std::pow(i + 1, cfg.skew));
+    }
+
+    std::discrete_distribution<int>              type_dist(weights.begin(), weights.end());
+    std::uniform_int_distribution<std::uint32_t> slot_dist(0, static_cast<std::uint32_t>(cfg.slots - 1));
+    std::uniform_real_distribution<double>       kind_dist(0.0, 1.0);
+
+    std::vector<op> stream(cfg.ops);
+
+    for(op &o : stream) {
+      double k = kind_dist(rng);
+
+      o.kind = k < cfg.reassign ? OP_REASSIGN : k < cfg.reassign + cfg.process ? OP_PROCESS : OP_CONSTRUCT;
+      o.type = static_cast<std::uint8_t>(type_dist(rng));
+      o.a    = slot_dist(rng);
+      o.b    = slot_dist(rng);
+      o.c    = slot_dist(rng);
+    }
+
+    return stream;
+  }
+
+  struct worker_result {
+    std::array<std::vector<std::uint32_t>, OP_KIND_COUNT> latencies; // ns
+    std::uint64_t checksum = 0;
+
+    bench::perf_counters::sample counters; // per operation
+  };
+
+  template<typename impl>
+  void emplace_type(typename impl::value &v, int type, std::uint64_t seq) {
+    switch(type) {
+    case 0 : impl::template emplace<msg0>(v, seq); break;
+    case 1 : impl::template emplace<msg1>(v, seq); break;
+    case 2 : impl::template emplace<msg2>(v, seq); break;
+    case 3 : impl::template emplace<msg3>(v, seq); break;
+    case 4 : impl::template emplace<msg4>(v, seq); break;
+    default: impl::template emplace<msg5>(v, seq); break;
+    }
+  }
+
+  template<typename impl>
+  void apply(op const &o, std::vector<typename impl::value> &slots, std::uint64_t &seq, std::uint64_t &checksum) {
+    switch(o.kind) {
+    case OP_CONSTRUCT:
+      emplace_type<impl>(slots[o.a], o.type, ++seq);
+      break;
+    case OP_REASSIGN:
+      impl::copy(slots[o.b], slots[o.c]);
+      impl::copy(slots[o.a], slots[o.b]);
+      break;
+    default:
+      checksum += impl::process(slots[o.a]);
+      break;
+    }
+  }
+
+  // Completion of the workers' barrier: the first phase ends when all workers are set up, the second when the
+  // last one is done. The completion runs before any worker is released, so the replay lies between the two.
+  struct replay_clock {
+    struct times {
+      std::chrono::steady_clock::time_point start;
+      std::chrono::steady_clock::time_point end;
+      int                                   phase = 0;
+    };
+
+    void operator()() noexcept {
+      (t->phase++ == 0 ? t->start : t->end) = std::chrono::steady_clock::now();
+    }
+
+    times *t;
+  };
+
+  using replay_barrier = std::barrier<replay_clock>;
+
+  // Sets up, waits at sync for the other workers, replays the stream and arrives at sync again when done.
+  template<typename impl>
+  void run_worker(std::vector<op> const &stream, config const &cfg, replay_barrier &sync, worker_result &result) {
+    using clock = std::chrono::steady_clock;
+    std::vector<typename impl::value> slots(cfg.slots);
+
+    for(std::size_t i = 0; i < cfg.slots; ++i) {
+      emplace_type<impl>(slots[i], static_cast<int>(i % type_count), i);
+    }
+
+    for(auto &l : result.latencies) {
+      l.reserve(stream.size() / cfg.sample + 1);
+    }
+
+    // counters have to be opened by the thread they measure
+    std::unique_ptr<bench::perf_counters> counters;
+    if(cfg.perf) {
+      counters = std::make_unique<bench::perf_counters>();
+    }
+
+    sync.arrive_and_wait();
+
+    if(counters) {
+      counters->start();
+    }
+
+    std::uint64_t seq      = 0;
+    std::uint64_t checksum = 0;
+
+    // the operations between two samples run untimed
+    for(std::size_t i = 0; i < stream.size(); i += cfg.sample) {
+      std::size_t last = std::min(stream.size(), i + cfg.sample);
+
+      auto start = clock::now();
+      apply<impl>(stream[i], slots, seq, checksum);
+      auto end = clock::now();
+
+      result.latencies[stream[i].kind].push_back(static_cast<std::uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+
+      for(std::size_t j = i + 1; j < last; ++j) {
+        apply<impl>(stream[j], slots, seq, checksum);
+      }
+    }
+
+    if(counters) {
+      result.counters = counters->stop(static_cast<double>(stream.size()));
+    }
+
+    result.checksum = checksum;
+
+    // the slots are destroyed after the clock stopped
+    sync.arrive_and_wait();
+  }
+
+  // Average of the per-thread counters. Threads may have opened different counters, so they are matched by
+  // name and every counter is averaged over the threads that have it.
+  bench::perf_counters::sample merge_counters(std::vector<worker_result> const &results) {
+    bench::perf_counters::sample merged;
+    std::vector<std::size_t>     counts;
+
+    for(worker_result const &r : results) {
+      for(auto const &[name, value] : r.counters.values) {
+        auto it = std::find_if(merged.values.begin(), merged.values.end(), [&](auto const &v) { return v.first == name; });
+
+        if(it == merged.values.end()) {
+          merged.values.emplace_back(name, value);
+          counts.push_back(1);
+        } else {
+          it->second += value;
+          ++counts[static_cast<std::size_t>(it - merged.values.begin())];
+        }
+      }
+    }
+
+    for(std::size_t i = 0; i < merged.values.size(); ++i) {
+      merged.values[i].second /= static_cast<double>(counts[i]);
+    }
+
+    return merged;
+  }
+
+  template<typename impl>
+  void run_impl(config const &cfg, std::ostream &out, bool &first) {
+    for(int thread_count : cfg.threads) {
+      std::vector<std::vector<op>> streams;
+      for(int t = 0; t < thread_count; ++t) {
+        streams.push_back(make_stream(cfg, 1000 + t));
+      }
+
+      std::vector<worker_result> results(thread_count);
+      std::vector<std::thread>   threads;
+      // only the replay is timed: from when all workers are set up until the last one is done
+      replay_clock::times times;
+      replay_barrier      sync(thread_count, replay_clock { &times });
+
+      for(int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&, t] { run_worker<impl>(streams[t], cfg, sync, results[t]); });
+      }
+
+      for(auto &t : threads) {
+        t.join();
+      }
+
+      double seconds = std::chrono::duration<double>(times.end - times.start).count();
+      double throughput = static_cast<double>(cfg.ops * thread_count) / seconds;
+
+      std::uint64_t checksum = 0;
+      for(worker_result const &r : results) {
+        checksum += r.checksum;
+      }
+
+      bench::perf_counters::sample counters = merge_counters(results);
+
+      if(cfg.perf && counters.values.empty() && first) {
+        std::cerr << "hardware performance counters are not available, continuing without them\n";
+      }
+
+      out << (first ? "\n" : ",\n")
+          << "    { \"impl\": \"" << impl::name << "\", \"threads\": " << thread_count
+          << ", \"seconds\": " << seconds
+          << ", \"throughput_ops_per_s\": " << throughput
+          << ", \"checksum\": " << checksum;
+
+      if(!counters.values.empty()) {
+        out << ", \"counters_per_op\": ";
+        bench::write_json_counters(out, counters);
+      }
+
+      out << ", \"ops\": {";
+      first = false;
+
+      std::cerr << impl::name << " x" << thread_count << ": " << throughput / 1e6 << " Mops/s\n";
+
+      for(int k = 0; k < OP_KIND_COUNT; ++k) {
+        std::vector<std::uint32_t> all;
+        for(worker_result &r : results) {
+          all.insert(all.end(), r.latencies[k].begin(), r.latencies[k].end());
+        }
+
+        std::size_t count = all.size();
+        auto p50  = bench::percentile(all, 0.5);
+        auto p99  = bench::percentile(all, 0.99);
+        auto p999 = bench::percentile(all, 0.999);
+
+        out << (k == 0 ? " " : ", ")
+            << '"' << op_names[k] << "\": { \"samples\": " << count
+            << ", \"p50_ns\": " << p50 << ", \"p99_ns\": " << p99 << ", \"p999_ns\": " << p999 << " }";
+
+        std::cerr << "  " << op_names[k] << ": p50 " << p50 << " ns, p99 " << p99 << " ns, p99.9 " << p999 << " ns\n";
+      }
+
+      out << " } }";
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<std::string> args(argv + 1, argv + argc);
+  config cfg = parse_config(args);
+
+  std::ostream &out = std::cout;
+  out << "{\n  \"suite\": \"factory_workload\",\n  \"config\": { \"ops\": " << cfg.ops
+      << ", \"slots\": " << cfg.slots << ", \"skew\": " << cfg.skew
+      << ", \"reassign\": " << cfg.reassign << ", \"process\": " << cfg.process
+      << ", \"sample\": " << cfg.sample << " },\n  \"results\": [";
+
+  bool first = true;
+
+  if(cfg.impl == "all" || cfg.impl == factory_impl   ::name) { run_impl<factory_impl   >(cfg, out, first); }
+  if(cfg.impl == "all" || cfg.impl == unique_ptr_impl::name) { run_impl<unique_ptr_impl>(cfg, out, first); }
+  if(cfg.impl == "all" || cfg.impl == variant_impl   ::name) { run_impl<variant_impl   >(cfg, out, first); }
+
+  out << "\n  ]\n}\n";
+}
@@ -0,0 +1,129 @@
+#ifndef INCLUDED_INPLACE_ALGORITHM_HH
+#define INCLUDED_INPLACE_ALGORITHM_HH
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <ranges>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Batch algorithms over ranges of factories.
+//
+// Calling a virtual function on a mixed range of factories jumps between implementations from one element
+// to the next, which defeats the branch predictor. Grouping the factories by the type they hold first and
+// then processing one type at a time turns that into runs of direct calls.
+
+namespace inplace {
+  // Pointers to the factories of a range, grouped by the type they hold (counting sort on factory::index()).
+  // Within a group, the factories keep the order of the range. Empty factories are collected separately.
+  //
+  // A type_partition can be reused with assign() to avoid reallocating for every batch.
+  template<typename factory_type>
+  class type_partition {
+  public:
+    static constexpr std::size_t type_count = factory_type::type_count;
+
+    type_partition() = default;
+
+    template<std::ranges::forward_range range_type>
+    explicit type_partition(range_type &&range) {
+      assign(std::forward<range_type>(range));
+    }
+
+    template<std::ranges::forward_range range_type>
+    void assign(range_type &&range) {
+      std::array<std::size_t, type_count + 1> counts = { };
+
+      for(factory_type &fct : range) {
+        ++counts[bucket_of(fct)];
+      }
+
+      bounds_[0] = 0;
+      for(std::size_t i = 0; i < counts.size(); ++i) {
+        bounds_[i + 1] = bounds_[i] + counts[i];
+      }
+
+      std::array<std::size_t, type_count + 1> pos;
+      std::copy(bounds_.begin(), bounds_.end() - 1, pos.begin());
+
+      elements_.resize(bounds_.back());
+      for(factory_type &fct : range) {
+        elements_[pos[bucket_of(fct)]++] = &fct;
+      }
+    }
+
+    // The factories holding the type at position index of the possible types.
+    std::span<factory_type * const> bucket(std::size_t index) const noexcept {
+      assert(index < type_count);
+      return bucket_span(index);
+    }
+
+    template<typename T>
+    std::span<factory_type * const> bucket() const noexcept {
+      return bucket_span(factory_type::template index_of<T>);
+    }
+
+    std::span<factory_type * const> empties() const noexcept {
+      return bucket_span(type_count);
+    }
+
+    // All factories in the partition, grouped by type, empty factories last.
+    std::span<factory_type * const> elements() const noexcept {
+      return elements_;
+    }
+
+    // Calls f with the object of every non-empty factory as its concrete type, one type after the other.
+    template<typename F>
+    void for_each(F &&f) const {
+      for_each_type(f, std::make_index_sequence<type_count>{});
+    }
+
+  private:
+    static std::size_t bucket_of(factory_type &fct) noexcept {
+      return std::min(fct.index(), type_count);
+    }
+
+    std::span<factory_type * const> bucket_span(std::size_t index) const noexcept {
+      return std::span<factory_type * const>(elements_).subspan(bounds_[index], bounds_[index + 1] - bounds_[index]);
+    }
+
+    template<typename F, std::size_t... I>
+    void for_each_type(F &f, std::index_sequence<I...>) const {
+      (for_each_in<I>(f), ...);
+    }
+
+    template<std::size_t I, typename F>
+    void for_each_in(F &f) const {
+      using T = typename factory_type::template type_at<I>;
+
+      for(factory_type *fct : bucket_span(I)) {
+        f(*fct->template get_if<T>());
+      }
+    }
+
+    std::vector<factory_type *>             elements_;
+    std::array<std::size_t, type_count + 2> bounds_ = { };
+  };
+
+  template<std::ranges::forward_range range_type>
+  type_partition(range_type &&) -> type_partition<std::remove_reference_t<std::ranges::range_reference_t<range_type>>>;
+
+  // Groups the factories in range by the type they hold.
+  template<std::ranges::forward_range range_type>
+  auto partition_by_type(range_type &&range) {
+    return type_partition(std::forward<range_type>(range));
+  }
+
+  // Calls f with the object of every non-empty factory in range as its concrete type, grouped by type.
+  // For repeated batches, keep a type_partition around and use assign() and for_each() instead.
+  template<std::ranges::forward_range range_type, typename F>
+  void for_each_grouped(range_type &&range, F &&f) {
+    partition_by_type(std::forward<range_type>(range)).for_each(std::forward<F>(f));
+  }
+}
+
+#endif
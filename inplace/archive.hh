@@ -0,0 +1,428 @@
+#ifndef INCLUDED_INPLACE_ARCHIVE_HH
+#define INCLUDED_INPLACE_ARCHIVE_HH
+
+#include "factory.hh"
+#include "type_dispatch.hh"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <climits>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+// Binary archives of factories.
+//
+// Every factory is written as the index of its type in possible_types (see basic_factory::index()),
+// followed by the payload of the held object. Trivially copyable types are written as their bytes, other
+// types provide a pair of customization points:
+//
+//   template<typename Writer> void serialize(Writer &out, T const &obj);  // found by ADL
+//   template<typename Reader> T(inplace::from_archive_t, Reader &in);      // constructor
+//
+// which call out.write(data, size) and in.read(data, size), or write_value and read_value below. A type
+// with both is serialized by its hooks. Loading constructs the object in the factory through that
+// constructor, so it does not have to be movable.
+//
+// Archives are in the byte order and layout of the machine that wrote them and are meant to be read back by
+// the same program, e.g. for checkpoints or to ship objects to a worker. save_all() starts the archive with a
+// header that holds a fingerprint of the type list (names, sizes and alignments), and load_all() rejects an
+// archive for other types. The fingerprint cannot see the hooks, though, so reading an archive with hooks that
+// do not match the ones that wrote it still gives garbage. save() and load() of single factories write and
+// expect no header; use save_header() and load_header() to frame them.
+//
+// Writers provide write(data, size), which copies the data, write_ref(data, size), which may keep a
+// reference to it until the next flush(), and flush(). Readers provide read(data, size) and at_end().
+
+namespace inplace {
+  // Tag for the deserializing constructor.
+  struct from_archive_t {
+    explicit from_archive_t() = default;
+  };
+
+  inline constexpr from_archive_t from_archive { };
+
+  // Malformed or truncated archive.
+  class archive_error : public std::runtime_error {
+  public:
+    using std::runtime_error::runtime_error;
+  };
+
+  // Appends to a byte vector.
+  class buffer_writer {
+  public:
+    explicit buffer_writer(std::vector<std::byte> &out) noexcept : out_(out) { }
+
+    void write(void const *data, std::size_t size) {
+      std::byte const *bytes = static_cast<std::byte const *>(data);
+      out_.insert(out_.end(), bytes, bytes + size);
+    }
+
+    void write_ref(void const *data, std::size_t size) { write(data, size); }
+    void flush() noexcept { }
+
+  private:
+    std::vector<std::byte> &out_;
+  };
+
+  // Writes to a file descriptor with writev(). Small pieces are collected in a buffer; larger trivially
+  // copyable objects are not copied at all but written straight from the factories, so those must not change
+  // until the next flush(). The destructor flushes what is left but cannot report errors, so call flush()
+  // first where they matter.
+  class fd_writer {
+  public:
+    // Pieces smaller than this are copied into the buffer, larger ones get their own iovec.
+    static constexpr std::size_t ref_threshold   = 256;
+    static constexpr std::size_t flush_threshold = 64 * 1024;
+
+    explicit fd_writer(int fd) : fd_(fd) {
+      buffer_.reserve(flush_threshold);
+    }
+
+    fd_writer(fd_writer const &) = delete;
+    fd_writer &operator=(fd_writer const &) = delete;
+
+    ~fd_writer() noexcept {
+      try {
+        flush();
+      } catch(...) {
+      }
+    }
+
+    void write(void const *data, std::size_t size) {
+      std::byte const *bytes = static_cast<std::byte const *>(data);
+
+      if(!pieces_.empty() && pieces_.back().ref == nullptr) {
+        pieces_.back().size += size;
+      } else {
+        pieces_.push_back({ nullptr, buffer_.size(), size });
+      }
+
+      buffer_.insert(buffer_.end(), bytes, bytes + size);
+
+      if(buffer_.size() >= flush_threshold) {
+        flush();
+      }
+    }
+
+    void write_ref(void const *data, std::size_t size) {
+      if(size < ref_threshold) {
+        write(data, size);
+        return;
+      }
+
+      pieces_.push_back({ static_cast<std::byte const *>(data), 0, size });
+
+      if(pieces_.size() >= static_cast<std::size_t>(IOV_MAX)) {
+        flush();
+      }
+    }
+
+    void flush() {
+      std::vector<iovec> iov;
+      iov.reserve(pieces_.size());
+
+      for(piece const &p : pieces_) {
+        std::byte const *base = p.ref != nullptr ? p.ref : buffer_.data() + p.offset;
+        iov.push_back({ const_cast<std::byte *>(base), p.size });
+      }
+
+      for(iovec *first = iov.data(), *last = iov.data() + iov.size(); first != last; ) {
+        ssize_t n = ::writev(fd_, first, static_cast<int>(std::min<std::ptrdiff_t>(last - first, IOV_MAX)));
+
+        if(n == -1) {
+          if(errno == EINTR) {
+            continue;
+          }
+
+          throw std::system_error(errno, std::generic_category(), "writev");
+        }
+
+        // nothing written although there is something left, so trying again would only spin
+        if(n == 0) {
+          throw std::system_error(EIO, std::generic_category(), "writev");
+        }
+
+        // skip what was written, which may end in the middle of an iovec
+        for(std::size_t written = static_cast<std::size_t>(n); written != 0; ) {
+          std::size_t step = std::min(written, first->iov_len);
+
+          first->iov_base  = static_cast<std::byte *>(first->iov_base) + step;
+          first->iov_len  -= step;
+          written         -= step;
+
+          if(first->iov_len == 0) {
+            ++first;
+          }
+        }
+
+        while(first != last && first->iov_len == 0) {
+          ++first;
+        }
+      }
+
+      pieces_.clear();
+      buffer_.clear();
+    }
+
+  private:
+    // Either a reference to the caller's data or a range in buffer_. Offsets stay valid when buffer_ grows.
+    struct piece {
+      std::byte const *ref;
+      std::size_t      offset;
+      std::size_t      size;
+    };
+
+    int                    fd_;
+    std::vector<std::byte> buffer_;
+    std::vector<piece>     pieces_;
+  };
+
+  // Reads from a contiguous range of bytes.
+  class buffer_reader {
+  public:
+    explicit buffer_reader(std::span<std::byte const> data) noexcept : data_(data) { }
+
+    void read(void *data, std::size_t size) {
+      if(size > data_.size() - pos_) {
+        throw archive_error("archive: unexpected end of data");
+      }
+
+      std::memcpy(data, data_.data() + pos_, size);
+      pos_ += size;
+    }
+
+    bool at_end() const noexcept { return pos_ == data_.size(); }
+
+  private:
+    std::span<std::byte const> data_;
+    std::size_t                pos_ = 0;
+  };
+
+  // Reads from a file descriptor through a buffer.
+  class fd_reader {
+  public:
+    explicit fd_reader(int fd, std::size_t buffer_size = 64 * 1024)
+      : fd_(fd),
+        buffer_(buffer_size)
+    { }
+
+    fd_reader(fd_reader const &) = delete;
+    fd_reader &operator=(fd_reader const &) = delete;
+
+    void read(void *data, std::size_t size) {
+      std::byte *dest = static_cast<std::byte *>(data);
+
+      while(size != 0) {
+        if(pos_ == end_ && !refill()) {
+          throw archive_error("archive: unexpected end of data");
+        }
+
+        std::size_t n = std::min(size, end_ - pos_);
+        std::memcpy(dest, buffer_.data() + pos_, n);
+
+        pos_ += n;
+        dest += n;
+        size -= n;
+      }
+    }
+
+    bool at_end() {
+      return pos_ == end_ && !refill();
+    }
+
+  private:
+    bool refill() {
+      ssize_t n;
+
+      do {
+        n = ::read(fd_, buffer_.data(), buffer_.size());
+      } while(n == -1 && errno == EINTR);
+
+      if(n == -1) {
+        throw std::system_error(errno, std::generic_category(), "read");
+      }
+
+      pos_ = 0;
+      end_ = static_cast<std::size_t>(n);
+
+      return n != 0;
+    }
+
+    int                    fd_;
+    std::vector<std::byte> buffer_;
+    std::size_t            pos_ = 0;
+    std::size_t            end_ = 0;
+  };
+
+  // Helpers for serialization hooks.
+  template<typename Writer, typename T>
+  requires std::is_trivially_copyable_v<T>
+  void write_value(Writer &out, T const &value) {
+    out.write(&value, sizeof(T));
+  }
+
+  template<typename T, typename Reader>
+  requires std::is_trivially_copyable_v<T>
+  T read_value(Reader &in) {
+    std::array<std::byte, sizeof(T)> raw;
+    in.read(raw.data(), raw.size());
+    return std::bit_cast<T>(raw);
+  }
+
+  namespace detail {
+    // Type index written for empty factories.
+    inline constexpr std::uint32_t archive_empty = UINT32_MAX;
+
+    inline constexpr std::uint64_t archive_magic = 0x696e706c61636533; // "inplace3"
+
+    template<typename factory_type>
+    struct archive_fingerprint;
+
+    template<typename storage_policy, typename base_type, typename... possible_types>
+    struct archive_fingerprint<basic_factory<storage_policy, base_type, possible_types...>> {
+      static std::uint64_t value() noexcept {
+        return type_list_fingerprint<possible_types...>();
+      }
+    };
+
+    // The element that load_all() loads the next factory into: emplace_back() of standard containers, or an
+    // empty factory appended with push_back(), e.g. in a factory_vector.
+    template<typename Container>
+    auto &append_empty(Container &out) {
+      if constexpr(requires { out.emplace_back(); }) {
+        return out.emplace_back();
+      } else {
+        return out.push_back(typename Container::value_type());
+      }
+    }
+
+    template<typename T, typename Writer>
+    concept has_serialize = requires(Writer &out, T const &obj) { serialize(out, obj); };
+
+    template<typename T, typename Reader>
+    concept has_from_archive = std::constructible_from<T, from_archive_t, Reader &>;
+
+    template<typename T, typename Writer>
+    void save_object(Writer &out, T const &obj) {
+      static_assert(has_serialize<T, Writer> || std::is_trivially_copyable_v<T>,
+                    "types that are not trivially copyable need a serialize() hook to be archived");
+
+      if constexpr(has_serialize<T, Writer>) {
+        serialize(out, obj);
+      } else {
+        out.write_ref(&obj, sizeof(T));
+      }
+    }
+
+    template<typename T, typename Reader, typename factory_type>
+    void load_object(Reader &in, factory_type &fct) {
+      static_assert(has_from_archive<T, Reader> || std::is_trivially_copyable_v<T>,
+                    "types that are not trivially copyable need a from_archive_t constructor to be loaded");
+
+      if constexpr(has_from_archive<T, Reader>) {
+        fct.template construct<T>(from_archive, in);
+      } else {
+        fct.template construct<T>(read_value<T>(in));
+      }
+    }
+  }
+
+  // Writes one factory, which may be empty.
+  template<typename Writer, typename storage_policy, typename base_type, typename... possible_types>
+  void save(Writer &out, basic_factory<storage_policy, base_type, possible_types...> const &fct) {
+    write_value(out, fct ? static_cast<std::uint32_t>(fct.index()) : detail::archive_empty);
+
+    if(fct) {
+      fct.visit([&](auto const &obj) { detail::save_object(out, obj); });
+    }
+  }
+
+  // Reads one factory. If this throws, fct is empty or keeps its old value.
+  template<typename Reader, typename storage_policy, typename base_type, typename... possible_types>
+  void load(Reader &in, basic_factory<storage_policy, base_type, possible_types...> &fct) {
+    std::uint32_t index = read_value<std::uint32_t>(in);
+
+    if(index == detail::archive_empty) {
+      fct.clear();
+    } else if(index >= sizeof...(possible_types)) {
+      throw archive_error("archive: type index out of range");
+    } else {
+      detail::dispatch_index<sizeof...(possible_types), void>(index, [&](auto i) {
+          detail::load_object<detail::type_at<decltype(i)::value, possible_types...>>(in, fct);
+        });
+    }
+  }
+
+  // Writes the header that identifies archives of factory_type.
+  template<typename factory_type, typename Writer>
+  void save_header(Writer &out) {
+    write_value(out, detail::archive_magic);
+    write_value(out, detail::archive_fingerprint<factory_type>::value());
+  }
+
+  // Reads a header written by save_header() and throws archive_error if it is not for factory_type.
+  template<typename factory_type, typename Reader>
+  void load_header(Reader &in) {
+    std::uint64_t magic       = read_value<std::uint64_t>(in);
+    std::uint64_t fingerprint = read_value<std::uint64_t>(in);
+
+    if(magic != detail::archive_magic) {
+      throw archive_error("archive: bad header");
+    }
+
+    if(fingerprint != detail::archive_fingerprint<factory_type>::value()) {
+      throw archive_error("archive: written for a different type list");
+    }
+  }
+
+  // Writes a header and all factories in range, and flushes the writer.
+  template<typename Writer, std::ranges::input_range Range>
+  void save_all(Writer &out, Range const &range) {
+    save_header<std::ranges::range_value_t<Range>>(out);
+
+    for(auto const &fct : range) {
+      save(out, fct);
+    }
+
+    out.flush();
+  }
+
+  // Reads an archive written by save_all() up to its end and appends the factories to out, e.g. a std::vector,
+  // std::deque or factory_vector of factories. Each one is loaded into the element that emplace_back() creates
+  // or, for containers without it, into an empty factory appended with push_back(). Returns the number of
+  // factories read.
+  template<typename Reader, typename Container>
+  std::size_t load_all(Reader &in, Container &out) {
+    load_header<typename Container::value_type>(in);
+
+    std::size_t count = 0;
+
+    while(!in.at_end()) {
+      try {
+        load(in, detail::append_empty(out));
+      } catch(...) {
+        out.pop_back();
+        throw;
+      }
+
+      ++count;
+    }
+
+    return count;
+  }
+}
+
+#endif
@@ -0,0 +1,203 @@
+#ifndef INCLUDED_INPLACE_ATOMIC_FACTORY_HH
+#define INCLUDED_INPLACE_ATOMIC_FACTORY_HH
+
+#include "hardware.hh"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace inplace {
+  // Publication slot for read-mostly polymorphic objects, e.g. configuration or strategies that worker threads
+  // consult on every request while a control thread occasionally replaces them.
+  //
+  // The object lives in one of slot_count factories. A writer constructs the new object in a free slot and
+  // then publishes it by switching the current slot; the previous object stays alive until all readers that
+  // saw it are done (a grace period) and is only then destroyed, when a writer needs its slot again or
+  // calls reclaim(). Readers never allocate and never block on a writer: read() is lock-free, an increment
+  // that is only repeated if a publication happened in the middle of it, and releasing the handle is one
+  // decrement. Writers are serialized by a mutex and wait for a slot to drain if all of them are in use, so
+  // slot_count bounds how many old objects can still be in use at the same time.
+  //
+  // Every slot counts its readers in stripe_count counters on separate cache lines, and each thread uses
+  // the same one of them, so readers on different threads do not write to the same line. A reader counts
+  // itself in and then checks that the slot is still current; a writer switches the slot and then sums up
+  // the counters. One of them sees the other, so a reader that raced with a publication backs out and tries
+  // again, and a writer never misses a reader that stayed.
+  template<typename factory_type, std::size_t slot_count = 3, std::size_t stripe_count = 8>
+  class atomic_factory {
+    static_assert(slot_count >= 2, "atomic_factory needs a slot to publish into besides the current one");
+    static_assert(stripe_count >= 1, "atomic_factory needs a reader counter");
+
+  private:
+    struct alignas(detail::cache_line_size) counter {
+      std::atomic<std::uint64_t> readers { 0 };
+    };
+
+    struct slot {
+      factory_type fct;
+
+      mutable std::array<counter, stripe_count> counters;
+
+      // Only accessed by writers: whether this slot was replaced and may still hold an object in use.
+      bool retired = false;
+
+      bool drained() const noexcept {
+        std::uint64_t sum = 0;
+
+        for(counter const &c : counters) {
+          sum += c.readers.load(std::memory_order_seq_cst);
+        }
+
+        return sum == 0;
+      }
+    };
+
+  public:
+    using base_type = std::remove_pointer_t<decltype(std::declval<factory_type const &>().get_ptr())>;
+
+    // Read access to the object that was current when it was taken. The object stays alive as long as the
+    // handle does, even if a new one is published in the meantime.
+    class read_handle {
+    public:
+      read_handle(read_handle &&other) noexcept
+        : slot_   (std::exchange(other.slot_, nullptr)),
+          counter_(other.counter_)
+      { }
+
+      read_handle(read_handle const &) = delete;
+      read_handle &operator=(read_handle const &) = delete;
+      read_handle &operator=(read_handle &&) = delete;
+
+      ~read_handle() noexcept {
+        if(slot_ != nullptr) {
+          counter_->readers.fetch_sub(1, std::memory_order_release);
+        }
+      }
+
+      factory_type const &factory() const noexcept { return slot_->fct; }
+
+      base_type const *get_ptr   () const noexcept { return slot_->fct.get_ptr(); }
+      base_type const &get       () const noexcept { return slot_->fct.get(); }
+      base_type const *operator->() const noexcept { return get_ptr(); }
+      base_type const &operator* () const noexcept { return get(); }
+
+      // false for an empty factory and for a handle that was moved from
+      explicit operator bool() const noexcept { return slot_ != nullptr && static_cast<bool>(slot_->fct); }
+
+    private:
+      friend class atomic_factory;
+
+      read_handle(slot const *s, counter *c) noexcept : slot_(s), counter_(c) { }
+
+      slot const *slot_;
+      counter    *counter_;
+    };
+
+    atomic_factory() noexcept = default;
+
+    atomic_factory(atomic_factory const &) = delete;
+    atomic_factory &operator=(atomic_factory const &) = delete;
+
+    // Lock-free, not wait-free: tries again if a writer published in the middle of it, so a reader can in
+    // principle be held up by a continuous stream of publications, never by a writer that stalls.
+    read_handle read() const noexcept {
+      std::size_t stripe = this_thread_stripe();
+      std::size_t index  = current_.load(std::memory_order_acquire);
+
+      for(;;) {
+        counter &c = slots_[index].counters[stripe];
+        c.readers.fetch_add(1, std::memory_order_seq_cst);
+
+        std::size_t now = current_.load(std::memory_order_seq_cst);
+
+        if(now == index) {
+          return read_handle(&slots_[index], &c);
+        }
+
+        c.readers.fetch_sub(1, std::memory_order_relaxed);
+        index = now;
+      }
+    }
+
+    // Constructs a T in a free slot and publishes it. Blocks while all other slots are still being read.
+    // If the construction throws, the current object stays published.
+    template<typename T, typename... Args>
+    void construct(Args&&... args) {
+      publish([&](factory_type &fct) { fct.template construct<T>(std::forward<Args>(args)...); });
+    }
+
+    // Publishes an empty factory.
+    void clear() {
+      publish([](factory_type &) { });
+    }
+
+    // Destroys the objects of all replaced slots that no reader uses any more.
+    void reclaim() noexcept {
+      std::lock_guard<std::mutex> lock(write_mutex_);
+
+      for(slot &s : slots_) {
+        try_reclaim(s);
+      }
+    }
+
+  private:
+    template<typename F>
+    void publish(F &&init) {
+      std::lock_guard<std::mutex> lock(write_mutex_);
+
+      slot &target = free_slot();
+      init(target.fct);
+
+      std::size_t index = static_cast<std::size_t>(&target - slots_.data());
+      std::size_t old   = current_.exchange(index, std::memory_order_seq_cst);
+
+      slots_[old].retired = true;
+    }
+
+    // A slot that is neither current nor read any more, emptied. Waits if there is none yet.
+    slot &free_slot() {
+      std::size_t current = current_.load(std::memory_order_relaxed);
+
+      for(;;) {
+        for(std::size_t i = 0; i < slot_count; ++i) {
+          if(i != current && (!slots_[i].retired || try_reclaim(slots_[i]))) {
+            return slots_[i];
+          }
+        }
+
+        std::this_thread::yield();
+      }
+    }
+
+    bool try_reclaim(slot &s) noexcept {
+      if(s.retired && s.drained()) {
+        s.fct.clear();
+        s.retired = false;
+      }
+
+      return !s.retired;
+    }
+
+    // Threads take the reader counters in turn.
+    static std::size_t this_thread_stripe() noexcept {
+      static std::atomic<std::size_t> next_stripe { 0 };
+      thread_local std::size_t const  stripe = next_stripe.fetch_add(1, std::memory_order_relaxed) % stripe_count;
+
+      return stripe;
+    }
+
+    // only written by publications, so readers share this line
+    alignas(detail::cache_line_size) std::atomic<std::size_t> current_ { 0 };
+
+    std::array<slot, slot_count> slots_;
+    std::mutex                   write_mutex_;
+  };
+}
+
+#endif
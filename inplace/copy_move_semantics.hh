@@ -1,6 +1,11 @@
 #ifndef INCLUDED_COPY_MOVE_SEMANTICS_HH
 #define INCLUDED_COPY_MOVE_SEMANTICS_HH
 
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <stdexcept>
 #include <type_traits>
 #include <utility>
 
@@ -14,6 +19,9 @@
 // 2. Support move construction if all types support copy or move construction
 // 3. Fall back on copy construction if the factory supports move but the concrete
 //    type in it only supports copy construction
+//
+// All type-specific operations are bundled in one constexpr operations table per allowed type,
+// so a factory only has to store a single pointer to the table of the type it currently holds.
 
 namespace inplace {
   namespace detail {
@@ -22,99 +30,176 @@ namespace inplace {
       template<typename T> using trait = std::disjunction<input_traits<T>...>;
     };
 
-    // Type-traits to decide whether and how to offer copy/move semantics.
-    // Offer: What the factory supports from the outside
-    // Require: what the copy_move_semantics in the background must handle.
+    // Type-traits to decide whether to offer copy/move semantics, i.e. what the factory supports from the outside.
     template<typename... possible_types>
     struct copy_move_traits {
-      // Copy: Offered when all possible types support copy; required in the same case.
-      static bool constexpr offer_copy   = std::conjunction_v<std::is_copy_constructible<possible_types>...>;
-      static bool constexpr require_copy = offer_copy;
-
-      // Move: Offered when all possible types support move or copy, required when at least one type supports move.
-      static bool constexpr offer_move   = std::conjunction_v<trait_or<std::is_move_constructible,
-                                                                       std::is_copy_constructible>::template trait<possible_types>...>;
-      static bool constexpr require_move = offer_move && std::disjunction_v<std::is_move_constructible<possible_types>...>;
-    };
+      // Copy: Offered when all possible types support copy.
+      static bool constexpr offer_copy = std::conjunction_v<std::is_copy_constructible<possible_types>...>;
+
+      // Move: Offered when all possible types support move or copy.
+      static bool constexpr offer_move = std::conjunction_v<trait_or<std::is_move_constructible,
+                                                                     std::is_copy_constructible>::template trait<possible_types>...>;
 
-    // Not all types support copy, not all types support move
-    // Factory supports neither copy or move.
-    //
-    // copy_move_semantics does nothing.
-    template<typename factory_type,
-             bool enable_copy,
-             bool enable_move>
-    struct copy_move_semantics {
-      template<typename T> requires factory_type::template allowed_type<T>
-      void set_type() { }
-      void clear   () { }
+      // Trivial: all possible types are trivially copyable, so copy and move of the factory are plain memcpys
+      // and the factory itself is trivially copyable.
+      static bool constexpr trivial = std::conjunction_v<std::conjunction<std::is_trivially_copyable<possible_types>,
+                                                                          std::is_trivially_copy_constructible<possible_types>>...>;
     };
 
-    // All types support copy, no type supports move.
-    // Factory will support move but internally use copy construction to achieve it.
-    //
-    // copy_move_semantics stores a function pointer to a type-specific copy function.
-    template<typename factory_type> class copy_move_semantics<factory_type, true, false> {
-    public:
-      template<typename T> requires factory_type::template allowed_type<T>
-      void set_type() { do_copy_ptr = &copy_move_semantics::copy_impl<T>; }
-      void clear   () { do_copy_ptr = &copy_move_semantics::copy_empty  ; }
-
-      void do_copy(factory_type const &from, factory_type &to) const { do_copy_ptr(from, to); }
-      // fallback to copy if move semantics are unavailable
-      void do_move(factory_type      &&from, factory_type &to) const { do_copy_ptr(from, to); }
-
-    private:
-      void (*do_copy_ptr)(factory_type const &from, factory_type &to) = copy_empty;
-
-      template<typename T> requires factory_type::template allowed_type<T>
-      static void copy_impl (factory_type const &from, factory_type &to) { to.template construct<T>(*static_cast<T const *>(from.storage())); }
-      static void copy_empty(factory_type const &    , factory_type &to) { to.clear(); } // copy from an empty factory.
+    // Placement construction of a T at mem.
+    template<typename T, typename... Args>
+    T *construct_in(void *mem, Args&&... args) {
+      return new(mem) T(std::forward<Args>(args)...);
+    }
+
+    // For non-moveable types: move construction falls back to copy
+    template<typename T>
+    T *construct_in(void *mem, T &&other) requires (!std::is_move_constructible_v<T>) {
+      return new(mem) T(other);
+    }
+
+    // The same for memory that is already typed as T, e.g. a union member. These work in constant expressions.
+    template<typename T, typename... Args>
+    constexpr T *construct_in(T *mem, Args&&... args) {
+      return std::construct_at(mem, std::forward<Args>(args)...);
+    }
+
+    template<typename T>
+    constexpr T *construct_in(T *mem, T &&other) requires (!std::is_move_constructible_v<T>) {
+      return std::construct_at(mem, other);
+    }
+
+    // Operations table for the object held by a factory. Entries for operations the factory does not
+    // offer are null.
+    template<typename factory_type>
+    struct type_ops {
+      std::size_t index; // position of the type in the factory's possible_types
+
+      // Offset of the base_type subobject from the start of the object. This is necessary because of multiple
+      // inheritance: if base_type is not the concrete type's first base class, then static_cast<base_type*>(obj)
+      // will give the wrong address. It is the same for every T, but can only be taken from a constructed
+      // object (virtual bases are found at runtime), so constructing a T records it, see record_base_offset.
+      // Objects constructed in constant expressions must have their base_type subobject at offset 0, the
+      // initial value, so factories built at compile time are right before anything was recorded.
+      alignas(std::atomic_ref<std::ptrdiff_t>::required_alignment)
+      mutable std::ptrdiff_t base_offset;
+
+      bool        spilled; // the object is stored out of line
+
+      void (*destroy )(factory_type &obj) noexcept;
+      void (*copy    )(factory_type const &from, factory_type &to);
+      void (*relocate)(factory_type       &from, factory_type &to); // to must be empty, from is empty afterwards
+      void (*swap    )(factory_type       &lhs , factory_type &rhs); // both must hold a T
+
+      // Assignment between factories that both hold a T. Null if T is not assignable that way, then
+      // assignment falls back to destruction and reconstruction.
+      void (*copy_assign)(factory_type const &from, factory_type &to);
+      void (*move_assign)(factory_type      &&from, factory_type &to);
     };
 
-    // All types support move, not all types support copy
-    // Factory will support move but not copy.
-    //
-    // copy_move_semantics stores a function pointer to a type-specific move function.
-    template<typename factory_type> class copy_move_semantics<factory_type, false, true> {
-    public:
-      template<typename T> requires factory_type::template allowed_type<T>
-      void set_type() { do_move_ptr = &copy_move_semantics::move_impl<T>; }
-      void clear   () { do_move_ptr = &copy_move_semantics::move_empty  ; }
+    // Stores offset in ops unless it is there already. Every construction of a T stores the same value, so
+    // the first one at runtime is all that changes the table.
+    template<typename factory_type>
+    void store_base_offset(type_ops<factory_type> const &ops, std::ptrdiff_t offset) noexcept {
+      std::atomic_ref<std::ptrdiff_t> recorded(ops.base_offset);
 
-      void do_move(factory_type &&from, factory_type &to) const { do_move_ptr(std::forward<factory_type>(from), to); }
+      if(recorded.load(std::memory_order_relaxed) != offset) {
+        recorded.store(offset, std::memory_order_relaxed);
+      }
+    }
+
+    // Records the offset of the base_type subobject of obj, a T that was just constructed, in the table of T.
+    template<typename base_type, typename T, typename factory_type>
+    constexpr void record_base_offset(type_ops<factory_type> const &ops, T *obj) {
+      if(std::is_constant_evaluated()) {
+        if(static_cast<void *>(static_cast<base_type *>(obj)) != static_cast<void *>(obj)) {
+          throw std::logic_error("base_type is not at the start of T, which a constant expression cannot handle");
+        }
+      } else {
+        store_base_offset(ops, reinterpret_cast<std::byte *>(static_cast<base_type *>(obj)) - reinterpret_cast<std::byte *>(obj));
+      }
+    }
+
+    // The base_type subobject of obj, an object of the type ops belongs to.
+    template<typename base_type, typename factory_type>
+    base_type *base_of(type_ops<factory_type> const &ops, void const *obj) noexcept {
+      std::ptrdiff_t offset = std::atomic_ref<std::ptrdiff_t>(ops.base_offset).load(std::memory_order_relaxed);
+      return std::launder(reinterpret_cast<base_type *>(static_cast<std::byte *>(const_cast<void *>(obj)) + offset));
+    }
+
+    // The operations for a concrete type T. enable_copy and enable_move decide which entries are filled in,
+    // spilled whether T lives out of line. Spilled objects are relocated and swapped by handing over the
+    // pointer to them.
+    template<typename factory_type, typename T, std::size_t index, bool enable_copy, bool enable_move, bool spilled>
+    struct type_ops_impl {
+      static constexpr void destroy(factory_type &obj) noexcept { obj.template destroy<T>(); }
+
+      static constexpr void copy(factory_type const &from, factory_type &to) {
+        to.template construct<T>(*from.template object<T>());
+      }
 
-    private:
-      void (*do_move_ptr)(factory_type &&from, factory_type &to) = move_empty;
+      static constexpr void copy_assign(factory_type const &from, factory_type &to) {
+        *to.template object<T>() = *from.template object<T>();
+      }
 
-      template<typename T> requires factory_type::template allowed_type<T>
-      static void move_impl (factory_type &&from, factory_type &to) { to.template construct<T>(std::move(*static_cast<T *>(from.storage()))); }
-      static void move_empty(factory_type &&    , factory_type &to) { to.clear(); } // move from an empty factory
-    };
+      static constexpr void move_assign(factory_type &&from, factory_type &to) {
+        *to.template object<T>() = std::move(*from.template object<T>());
+      }
 
-    // All types support copy, some types support move.
-    // Factory supports copy and move, and it will use proper move semantics when available.
-    //
-    // copy_move_semantics uses the copy-only and move-only cases of itself to provide both operations
-    template<typename factory_type> class copy_move_semantics<factory_type, true, true> {
-    public:
-      void clear() {
-        cs_.clear();
-        ms_.clear();
+      static constexpr void relocate(factory_type &from, factory_type &to) {
+        if constexpr(spilled) {
+          to.template take_spilled<T>(from);
+        } else {
+          // falls back to copy if T cannot be moved, see construct_in
+          to.template construct<T>(std::move(*from.template object<T>()));
+          from.clear();
+        }
       }
 
-      template<typename T> requires factory_type::template allowed_type<T>
-      void set_type() {
-        cs_.template set_type<T>();
-        ms_.template set_type<T>();
+      static constexpr void swap(factory_type &lhs, factory_type &rhs) {
+        if constexpr(spilled) {
+          factory_type tmp;
+          tmp.template take_spilled<T>(lhs);
+          lhs.template take_spilled<T>(rhs);
+          rhs.template take_spilled<T>(tmp);
+        } else {
+          using std::swap;
+          swap(*lhs.template object<T>(), *rhs.template object<T>());
+        }
       }
 
-      void do_copy(factory_type const &from, factory_type &to) const { cs_.do_copy(                           from , to); }
-      void do_move(factory_type      &&from, factory_type &to) const { ms_.do_move(std::forward<factory_type>(from), to); }
+      static constexpr auto copy_ptr() {
+        if constexpr(enable_copy) { return &copy; } else { return decltype(&copy)(nullptr); }
+      }
+
+      static constexpr auto relocate_ptr() {
+        if constexpr(enable_move) { return &relocate; } else { return decltype(&relocate)(nullptr); }
+      }
+
+      static constexpr auto swap_ptr() {
+        if constexpr(enable_move && (spilled || std::is_swappable_v<T>)) { return &swap; } else { return decltype(&swap)(nullptr); }
+      }
+
+      static constexpr auto copy_assign_ptr() {
+        if constexpr(enable_copy && std::is_copy_assignable_v<T>) { return &copy_assign; } else { return decltype(&copy_assign)(nullptr); }
+      }
+
+      // Spilled objects are cheaper to hand over than to assign.
+      static constexpr auto move_assign_ptr() {
+        if constexpr(enable_move && !spilled && std::is_move_assignable_v<T>) { return &move_assign; } else { return decltype(&move_assign)(nullptr); }
+      }
 
-    private:
-      copy_move_semantics<factory_type, true, false> cs_;
-      copy_move_semantics<factory_type, false, true> ms_;
+      static constexpr type_ops<factory_type> table = {
+        index,
+        0,
+        spilled,
+        &destroy,
+        copy_ptr(),
+        relocate_ptr(),
+        swap_ptr(),
+        copy_assign_ptr(),
+        move_assign_ptr()
+      };
     };
   }
 }
@@ -2,21 +2,75 @@
 #define INCLUDED_INPLACE_FACTORY_HH
 
 #include "copy_move_semantics.hh"
+#include "relocation.hh"
+#include "storage_policy.hh"
+#include "type_dispatch.hh"
 
-#include <algorithm>
 #include <cassert>
 #include <concepts>
 #include <cstddef>
+#include <memory>
+#include <new>
+#include <stdexcept>
 #include <type_traits>
 #include <utility>
 
 namespace inplace {
+  namespace detail {
+    // Storage for one of Ts, as a union so objects can be constructed in it in constant expressions. The owner
+    // constructs and destroys the members. Without one of them, the empty member at the end of the chain is
+    // active, so that an empty storage is still a complete value.
+    template<typename... Ts>
+    union variadic_union {
+      struct none_type { };
+
+      constexpr variadic_union() noexcept : none() { }
+
+      none_type none;
+    };
+
+    template<typename T, typename... Rest>
+    union variadic_union<T, Rest...> {
+      constexpr variadic_union() noexcept : tail() { }
+      constexpr ~variadic_union() requires std::conjunction_v<std::is_trivially_destructible<T>,
+                                                              std::is_trivially_destructible<Rest>...> = default;
+      constexpr ~variadic_union() { }
+
+      template<std::size_t I>
+      constexpr auto &get() noexcept {
+        if constexpr(I == 0) {
+          return head;
+        } else {
+          return tail.template get<I - 1>();
+        }
+      }
+
+      // Makes the empty member active again after the owner destroyed its object.
+      constexpr void reset() noexcept {
+        std::construct_at(&tail);
+      }
+
+      T                       head;
+      variadic_union<Rest...> tail;
+    };
+  }
+
+  // Thrown by construct_by_index if there is no type at the index that can be constructed from the arguments.
+  class bad_type_index : public std::out_of_range {
+  public:
+    using std::out_of_range::out_of_range;
+  };
+
   // In-place factory, i.e. sort of a polymorphic variant.
   //
   // This is useful when the overhead of dynamic allocation has to be avoided but runtime polymorphy
-  // is still desired.
-  template<typename base_type, std::derived_from<base_type>... possible_types>
-  class factory {
+  // is still desired. storage_policy decides which types are stored inline, see storage_policy.hh;
+  // factory stores all of them inline.
+  //
+  // Factories of inline types can be used in constant expressions as far as the types allow it, so tables of
+  // polymorphic objects can be built at compile time and declared constinit or constexpr.
+  template<typename storage_policy, typename base_type, std::derived_from<base_type>... possible_types>
+  class basic_factory {
     static_assert(sizeof...(possible_types) > 0, "possible_types is empty");
 
   private:
@@ -25,117 +79,382 @@ namespace inplace {
     template<typename T>
     static constexpr bool allowed_type = std::disjunction_v<std::is_same<T, possible_types>...>;
 
+    template<typename T>
+    static constexpr bool spills = storage_policy::template spill<T>;
+
+    static constexpr bool any_spills = (spills<possible_types> || ...);
+
+    // Trivially copyable if all possible types are and none of them is stored out of line.
+    static constexpr bool trivial = cpmov::trivial && !any_spills;
+
+    // A trivially copyable type may still have no assignment, e.g. because of a const member, and then neither
+    // has the union that holds it. Such factories are assigned by copying the whole factory over, which makes
+    // them assignable but not trivially copyable.
+    static constexpr bool trivial_assign = trivial && (std::is_trivially_copy_assignable_v<possible_types> && ...)
+                                                   && (std::is_trivially_move_assignable_v<possible_types> && ...);
+
+    // What storage_ holds for a T: the object itself or a pointer to it.
+    template<typename T>
+    using slot_type = std::conditional_t<spills<T>, void *, T>;
+
   public:
-    factory() noexcept = default;
+    using policy_type = storage_policy;
+
+    // The possible types, in order. index() refers to positions in this list.
+    static constexpr std::size_t type_count = sizeof...(possible_types);
+    static constexpr std::size_t npos       = static_cast<std::size_t>(-1);
+
+    template<std::size_t I>
+    using type_at = detail::type_at<I, possible_types...>;
+
+    template<typename T>
+    requires allowed_type<T>
+    static constexpr std::size_t index_of = detail::index_of<T, possible_types...>;
+
+    constexpr basic_factory() noexcept = default;
+
+    // If all possible types are trivially copyable and stored inline, so is the factory: copy and move are memcpys of the storage.
+    // A moved-from trivial factory keeps its value.
+    basic_factory(basic_factory const &) requires trivial = default;
+    basic_factory(basic_factory      &&) requires trivial = default;
 
-    factory(factory const &other) requires cpmov::offer_copy {
+    constexpr basic_factory(basic_factory const &other) requires (cpmov::offer_copy && !trivial) {
       *this = other;
     }
 
-    factory(factory &&other) requires cpmov::offer_move {
-      *this = std::forward<factory>(other);
+    constexpr basic_factory(basic_factory &&other) requires (cpmov::offer_move && !trivial) {
+      *this = std::forward<basic_factory>(other);
     }
 
     template<typename... Args>
-    factory(std::invocable<factory&, Args...> auto &&f, Args&&... args) {
+    constexpr basic_factory(std::invocable<basic_factory&, Args...> auto &&f, Args&&... args) {
       f(*this, std::forward<Args>(args)...);
     }
 
-    // operator= cannot sensibly use the value types; operator= because the other factory may contain a different type,
-    // so we always use constructors for assignment.
-    factory &operator=(factory const &other) requires cpmov::offer_copy {
+    // If both factories hold the same type, assignment uses that type's operator= where available, so objects
+    // that own resources can reuse them. Otherwise the held object is destroyed and a new one constructed.
+    // A moved-from factory is empty either way.
+    basic_factory &operator=(basic_factory const &) requires trivial_assign = default;
+    basic_factory &operator=(basic_factory      &&) requires trivial_assign = default;
+
+    constexpr basic_factory &operator=(basic_factory const &other) requires (trivial && !trivial_assign) {
       if(&other != this) {
-        other.cpmov_handler_.do_copy(other, *this);
+        std::construct_at(this, other);
       }
 
       return *this;
     }
 
-    factory &operator=(factory &&other) requires cpmov::offer_move  {
+    constexpr basic_factory &operator=(basic_factory &&other) requires (trivial && !trivial_assign) {
+      return *this = other;
+    }
+
+    constexpr basic_factory &operator=(basic_factory const &other) requires (cpmov::offer_copy && !trivial) {
       if(&other != this) {
-        other.cpmov_handler_.do_move(std::forward<factory>(other), *this);
-        other.clear();
+        if(other.is_initialized() && ops_ == other.ops_ && ops_->copy_assign != nullptr) {
+          ops_->copy_assign(other, *this);
+        } else if(other.is_initialized()) {
+          other.ops_->copy(other, *this);
+        } else {
+          clear();
+        }
       }
 
       return *this;
     }
 
-    ~factory() noexcept {
+    constexpr basic_factory &operator=(basic_factory &&other) requires (cpmov::offer_move && !trivial) {
+      if(&other != this) {
+        if(other.is_initialized() && ops_ == other.ops_ && ops_->move_assign != nullptr) {
+          ops_->move_assign(std::move(other), *this);
+          other.clear();
+        } else {
+          clear();
+
+          if(other.is_initialized()) {
+            other.ops_->relocate(other, *this);
+          }
+        }
+      }
+
+      return *this;
+    }
+
+    ~basic_factory() requires trivial = default;
+
+    constexpr ~basic_factory() noexcept requires (!trivial) {
       clear();
     }
 
-    void clear() noexcept {
+    constexpr void clear() noexcept {
       if(is_initialized()) {
-        obj_ptr_->~base_type();
-        obj_ptr_ = nullptr;
-        cpmov_handler_.clear();
+        if constexpr(!trivial) {
+          ops_->destroy(*this);
+        }
+
+        ops_ = nullptr;
+      }
+    }
+
+    // Swaps in place when both factories hold the same swappable type, otherwise through a temporary.
+    constexpr void swap(basic_factory &other) requires cpmov::offer_move {
+      if(ops_ == other.ops_ && is_initialized() && ops_->swap != nullptr) {
+        ops_->swap(*this, other);
+      } else if(&other != this) {
+        basic_factory tmp(std::move(other));
+        other = std::move(*this);
+        *this = std::move(tmp);
       }
     }
 
+    friend constexpr void swap(basic_factory &lhs, basic_factory &rhs) requires cpmov::offer_move {
+      lhs.swap(rhs);
+    }
+
     template<typename T, typename... Args>
     requires allowed_type<T>
-    base_type *construct(Args&&... args) {
+    constexpr base_type *construct(Args&&... args) {
       clear();
-      obj_ptr_ = do_construct<T>(std::forward<Args>(args)...);
-      cpmov_handler_.template set_type<T>();
+      detail::record_base_offset<base_type>(ops_for<T>::table, do_construct<T>(std::forward<Args>(args)...));
+      ops_ = &ops_for<T>::table;
+
+      return get_ptr();
+    }
+
+    // If the factory already holds a T that is assignable from the single argument, assigns it to the held object,
+    // otherwise constructs a new T from args. Assignment keeps resources of the held object, e.g. buffer capacity.
+    template<typename T, typename... Args>
+    requires allowed_type<T>
+    constexpr base_type *emplace_or_assign(Args&&... args) {
+      if constexpr(sizeof...(Args) == 1 && (std::is_assignable_v<T&, Args> && ...)) {
+        if(T *obj = get_if<T>()) {
+          ((*obj = std::forward<Args>(args)), ...);
+          return get_ptr();
+        }
+      }
+
+      return construct<T>(std::forward<Args>(args)...);
+    }
+
+    // Constructs the type at position index in possible_types from args, e.g. from a type tag that was read
+    // from a message. This is the counterpart of index(). Types that cannot be constructed from args are left
+    // out of the dispatch and throw bad_type_index, as do indices past the end of the list; the factory keeps
+    // its value then.
+    template<typename... Args>
+    constexpr base_type *construct_by_index(std::size_t index, Args&&... args) {
+      if(index >= type_count) {
+        throw bad_type_index("construct_by_index: type index out of range");
+      }
 
-      return obj_ptr_;
+      return detail::dispatch_index<type_count, base_type *>(index, [&](auto i) -> base_type * {
+          using T = type_at<decltype(i)::value>;
+
+          if constexpr(std::is_constructible_v<T, Args...>) {
+            return construct<T>(std::forward<Args>(args)...);
+          } else {
+            throw bad_type_index("construct_by_index: type cannot be constructed from these arguments");
+          }
+        });
     }
 
-    bool is_initialized() const noexcept {
-      return get_ptr() != nullptr;
+    constexpr bool is_initialized() const noexcept {
+      return ops_ != nullptr;
     }
 
-    base_type *get_ptr() const noexcept {
-      return obj_ptr_;
+    constexpr base_type *get_ptr() const noexcept {
+      if(!is_initialized()) {
+        return nullptr;
+      }
+
+      // The base offset works on byte addresses, so constant expressions go through the concrete type instead.
+      if(std::is_constant_evaluated()) {
+        return do_visit<base_type *>(const_cast<basic_factory &>(*this), [](base_type &obj) { return &obj; });
+      }
+
+      return detail::base_of<base_type>(*ops_, held_object());
     }
 
-    base_type &get() const noexcept {
+    constexpr base_type &get() const noexcept {
       assert(get_ptr() != nullptr);
       return *get_ptr();
     }
 
-    base_type *operator->() const noexcept {
+    constexpr base_type *operator->() const noexcept {
       return get_ptr();
     }
 
-    base_type &operator*() const noexcept {
+    constexpr base_type &operator*() const noexcept {
       return get();
     }
 
-    explicit operator bool() const noexcept {
+    constexpr explicit operator bool() const noexcept {
       return is_initialized();
     }
 
+    // Position of the held object's type in possible_types, npos if the factory is empty. This is a cheap
+    // discriminator for grouping or sorting factories by type, and it only depends on the order of
+    // possible_types, so it can be stored and passed to construct_by_index later.
+    constexpr std::size_t index() const noexcept {
+      return is_initialized() ? ops_->index : npos;
+    }
+
+    // The held object as its concrete type if that is T, nullptr otherwise.
+    template<typename T>
+    requires allowed_type<T>
+    constexpr T *get_if() noexcept {
+      return index() == index_of<T> ? object<T>() : nullptr;
+    }
+
+    template<typename T>
+    requires allowed_type<T>
+    constexpr T const *get_if() const noexcept {
+      return index() == index_of<T> ? object<T>() : nullptr;
+    }
+
+    // Calls f with the held object as its concrete type, i.e. as T& for the T that was constructed, and
+    // returns the result. This dispatches on the stored type instead of going through the vtable, so
+    // calls to final overrides can be inlined. The factory must not be empty.
+    template<typename F>
+    constexpr decltype(auto) visit(F &&f) {
+      return visit<detail::visit_result_t<F, possible_types &...>>(std::forward<F>(f));
+    }
+
+    template<typename F>
+    constexpr decltype(auto) visit(F &&f) const {
+      return visit<detail::visit_result_t<F, possible_types const &...>>(std::forward<F>(f));
+    }
+
+    // Same as above, but converts the results to R.
+    template<typename R, typename F>
+    constexpr R visit(F &&f) {
+      return do_visit<R>(*this, std::forward<F>(f));
+    }
+
+    template<typename R, typename F>
+    constexpr R visit(F &&f) const {
+      return do_visit<R>(*this, std::forward<F>(f));
+    }
+
   private:
-    template<typename T, bool, bool> friend struct detail::copy_move_semantics;
+    template<typename, typename, std::size_t, bool, bool, bool> friend struct detail::type_ops_impl;
 
+    template<typename T>
+    using ops_for = detail::type_ops_impl<basic_factory,
+                                          T,
+                                          detail::index_of<T, possible_types...>,
+                                          cpmov::offer_copy,
+                                          cpmov::offer_move,
+                                          spills<T>>;
+
+    template<typename R, typename self_type, typename F>
+    static constexpr R do_visit(self_type &self, F &&f) {
+      assert(self.is_initialized());
+
+      return detail::dispatch_index<sizeof...(possible_types), R>(self.ops_->index, [&](auto i) -> R {
+        using T = detail::type_at<decltype(i)::value, possible_types...>;
+
+        return detail::invoke_r<R>(std::forward<F>(f), *self.template object<T>());
+      });
+    }
+
+    // Constructs a T in storage_, or out of line if the storage policy spills T.
     template<typename T, typename... Args>
-    T *do_construct(Args&&... args) {
-      return new(storage()) T(std::forward<Args>(args)...);
+    constexpr T *do_construct(Args&&... args) {
+      if constexpr(spills<T>) {
+        std::pmr::memory_resource *resource = storage_policy::resource();
+        void *mem = resource->allocate(sizeof(T), alignof(T));
+
+        try {
+          return adopt_spilled(detail::construct_in<T>(mem, std::forward<Args>(args)...));
+        } catch(...) {
+          resource->deallocate(mem, sizeof(T), alignof(T));
+          throw;
+        }
+      } else {
+        return detail::construct_in<T>(&slot<T>(), std::forward<Args>(args)...);
+      }
     }
 
-    // For non-moveable types: move construction falls back to copy
     template<typename T>
-    T *do_construct(T &&other) requires (!std::is_move_constructible_v<T>) {
-      return new(storage()) T(other);
-    };
+    T *adopt_spilled(T *obj) noexcept {
+      std::construct_at(&slot<T>(), obj);
+      return obj;
+    }
 
-    void       *storage()       noexcept { return storage_; }
-    void const *storage() const noexcept { return storage_; }
+    // Destroys the held T and releases its memory if it was spilled.
+    template<typename T>
+    constexpr void destroy() noexcept {
+      T *obj = object<T>();
+      obj->~T();
 
-    alignas(possible_types...)
-    std::byte storage_[std::max({sizeof(possible_types)...})];
+      if constexpr(spills<T>) {
+        storage_policy::resource()->deallocate(obj, sizeof(T), alignof(T));
+      } else {
+        storage_.reset();
+      }
+    }
 
-    // pointer-to-base referencing the object constructed in storage_. This is necessary
-    // because of multiple inheritance: if base_type is not the concrete type's first base
-    // class, then static_cast<base_type*>(storage()) will give the wrong address.
-    base_type *obj_ptr_ = nullptr;
+    // Hands over a spilled object from other to this (empty) factory without touching the object itself.
+    template<typename T>
+    void take_spilled(basic_factory &other) noexcept {
+      adopt_spilled(other.template object<T>());
+      ops_ = other.ops_;
+      other.ops_ = nullptr;
+    }
+
+    // The held object; it must be a T.
+    template<typename T>
+    constexpr T *object() noexcept {
+      if constexpr(spills<T>) {
+        return static_cast<T *>(spilled_object());
+      } else {
+        return &slot<T>();
+      }
+    }
+
+    template<typename T>
+    constexpr T const *object() const noexcept {
+      return const_cast<basic_factory *>(this)->template object<T>();
+    }
 
-    // cpmov_handler_ is empty when neither copy nor move are supported.
-    [[no_unique_address]]
-    detail::copy_move_semantics<factory, cpmov::require_copy, cpmov::require_move> cpmov_handler_;
+    // The member of storage_ for a T.
+    template<typename T>
+    constexpr slot_type<T> &slot() noexcept {
+      return storage_.template get<detail::index_of<T, possible_types...>>();
+    }
+
+    void       *storage()       noexcept { return &storage_; }
+    void const *storage() const noexcept { return &storage_; }
+
+    void *spilled_object() const noexcept {
+      return *std::launder(static_cast<void * const *>(storage()));
+    }
+
+    // Start of the held object: storage_ itself, or what it points to if the object was spilled.
+    void const *held_object() const noexcept {
+      if constexpr(any_spills) {
+        if(ops_->spilled) {
+          return spilled_object();
+        }
+      }
+
+      return storage();
+    }
+
+    detail::variadic_union<slot_type<possible_types>...> storage_;
+
+    // operations table of the type currently held, nullptr when empty.
+    detail::type_ops<basic_factory> const *ops_ = nullptr;
   };
+
+  template<typename base_type, std::derived_from<base_type>... possible_types>
+  using factory = basic_factory<inline_storage, base_type, possible_types...>;
+
+  // A factory does not point into itself, so it can be relocated bytewise if every type it stores inline
+  // can. Spilled objects stay where they are.
+  template<typename storage_policy, typename base_type, std::derived_from<base_type>... possible_types>
+  struct is_trivially_relocatable<basic_factory<storage_policy, base_type, possible_types...>>
+    : std::bool_constant<((storage_policy::template spill<possible_types> || is_trivially_relocatable_v<possible_types>) && ...)> { };
 }
 
 #endif
@@ -0,0 +1,260 @@
+#ifndef INCLUDED_INPLACE_FACTORY_POOL_HH
+#define INCLUDED_INPLACE_FACTORY_POOL_HH
+
+#include "factory.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace inplace {
+  // Fixed-capacity pool of factories with stable addresses.
+  //
+  // All slots are allocated up front; emplace and erase only move slot numbers between the free list and the
+  // caller, so there is no allocation after construction. Objects are referred to through handles that carry
+  // the generation of their slot, which is bumped every time the slot is freed. A handle to an erased object
+  // is therefore detected instead of silently referring to whatever was constructed in the slot since.
+  //
+  // The free list is a lock-free stack, so emplace and erase may be called from any thread. Threads that
+  // allocate a lot should use a cache, which takes and returns slots in batches and leaves the shared list
+  // alone most of the time. Access to the objects themselves is not synchronized by the pool.
+  template<typename base_type, std::derived_from<base_type>... possible_types>
+  class factory_pool {
+  public:
+    using factory_type = factory<base_type, possible_types...>;
+
+    class handle {
+    public:
+      handle() noexcept = default;
+
+      explicit operator bool() const noexcept { return index_ != npos; }
+
+      friend bool operator==(handle const &, handle const &) = default;
+
+    private:
+      friend class factory_pool;
+
+      handle(std::uint32_t index, std::uint32_t generation) noexcept
+        : index_(index), generation_(generation) { }
+
+      std::uint32_t index_      = npos;
+      std::uint32_t generation_ = 0;
+    };
+
+    // Slot cache for one thread. It must not outlive the pool; on destruction, cached slots go back to it.
+    class cache {
+    public:
+      explicit cache(factory_pool &pool) noexcept : pool_(pool) { }
+
+      cache(cache const &) = delete;
+      cache &operator=(cache const &) = delete;
+
+      ~cache() noexcept {
+        while(count_ != 0) {
+          pool_.push(slots_[--count_]);
+        }
+      }
+
+      // Same as factory_pool::emplace.
+      template<typename T, typename... Args>
+      handle emplace(Args&&... args) {
+        if(count_ == 0) {
+          refill();
+        }
+
+        if(count_ == 0) {
+          return handle();
+        }
+
+        return pool_.template construct_at<T>(slots_[count_ - 1], [this] { --count_; }, std::forward<Args>(args)...);
+      }
+
+      // Same as factory_pool::erase.
+      bool erase(handle h) noexcept {
+        if(!pool_.release(h)) {
+          return false;
+        }
+
+        if(count_ == capacity) {
+          flush();
+        }
+
+        slots_[count_++] = h.index_;
+        return true;
+      }
+
+    private:
+      static constexpr std::size_t capacity = 32;
+
+      void refill() noexcept {
+        while(count_ < capacity / 2) {
+          std::uint32_t index = pool_.pop();
+
+          if(index == npos) {
+            break;
+          }
+
+          slots_[count_++] = index;
+        }
+      }
+
+      // returns the older half of the cached slots
+      void flush() noexcept {
+        for(std::size_t i = 0; i < capacity / 2; ++i) {
+          pool_.push(slots_[i]);
+        }
+
+        std::move(slots_ + capacity / 2, slots_ + count_, slots_);
+        count_ -= capacity / 2;
+      }
+
+      factory_pool &pool_;
+      std::uint32_t slots_[capacity];
+      std::size_t   count_ = 0;
+    };
+
+    explicit factory_pool(std::size_t capacity)
+      : slots_(std::make_unique<slot[]>(capacity)),
+        capacity_(capacity)
+    {
+      assert(capacity < npos);
+
+      for(std::size_t i = capacity; i-- != 0; ) {
+        push(static_cast<std::uint32_t>(i));
+      }
+    }
+
+    factory_pool(factory_pool const &) = delete;
+    factory_pool &operator=(factory_pool const &) = delete;
+
+    std::size_t capacity() const noexcept { return capacity_; }
+
+    // Constructs a T in a free slot. Returns an empty handle if the pool is exhausted.
+    template<typename T, typename... Args>
+    handle emplace(Args&&... args) {
+      std::uint32_t index = pop();
+
+      if(index == npos) {
+        return handle();
+      }
+
+      try {
+        return construct_at<T>(index, [] { }, std::forward<Args>(args)...);
+      } catch(...) {
+        push(index);
+        throw;
+      }
+    }
+
+    // Destroys the object h refers to and frees its slot. Returns false if h is stale or empty.
+    bool erase(handle h) noexcept {
+      if(!release(h)) {
+        return false;
+      }
+
+      push(h.index_);
+      return true;
+    }
+
+    // The object h refers to, nullptr if h is stale or empty.
+    base_type *get(handle h) const noexcept {
+      factory_type *fct = get_factory(h);
+      return fct != nullptr ? fct->get_ptr() : nullptr;
+    }
+
+    factory_type *get_factory(handle h) const noexcept {
+      if(!h || h.index_ >= capacity_) {
+        return nullptr;
+      }
+
+      slot &s = slots_[h.index_];
+      return s.generation.load(std::memory_order_acquire) == h.generation_ && s.fct ? &s.fct : nullptr;
+    }
+
+  private:
+    static constexpr std::uint32_t npos = static_cast<std::uint32_t>(-1);
+
+    // free list head: ABA tag in the upper half, index + 1 of the top slot in the lower half (0 if empty)
+    static constexpr std::uint64_t index_mask = 0xffffffff;
+
+    struct slot {
+      factory_type               fct;
+      std::atomic<std::uint32_t> generation { 0 };
+      std::atomic<std::uint32_t> next       { 0 };   // free list successor, index + 1
+    };
+
+    // Constructs a T in the free slot index; taken() is called once the slot is in use.
+    template<typename T, typename F, typename... Args>
+    handle construct_at(std::uint32_t index, F &&taken, Args&&... args) {
+      slot &s = slots_[index];
+
+      s.fct.template construct<T>(std::forward<Args>(args)...);
+      taken();
+
+      return handle(index, s.generation.load(std::memory_order_relaxed));
+    }
+
+    // Destroys the object, invalidates handles to it. The slot is not free yet.
+    //
+    // Bumping the generation claims the slot, so of several threads that erase the same handle only one
+    // destroys the object and frees the slot; the others see a stale handle. The factory is only touched
+    // after the claim: another thread may be destroying or constructing an object in it until then. A slot
+    // only has the generation of a live handle while it holds that handle's object, so the claim is all the
+    // validation a handle needs.
+    bool release(handle h) noexcept {
+      if(!h || h.index_ >= capacity_) {
+        return false;
+      }
+
+      slot          &s        = slots_[h.index_];
+      std::uint32_t  expected = h.generation_;
+
+      if(!s.generation.compare_exchange_strong(expected, h.generation_ + 1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+        return false;
+      }
+
+      s.fct.clear();
+      return true;
+    }
+
+    void push(std::uint32_t index) noexcept {
+      std::uint64_t head = head_.load(std::memory_order_relaxed);
+      std::uint64_t new_head;
+
+      do {
+        slots_[index].next.store(static_cast<std::uint32_t>(head & index_mask), std::memory_order_relaxed);
+        new_head = (((head >> 32) + 1) << 32) | (index + 1);
+      } while(!head_.compare_exchange_weak(head, new_head, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    std::uint32_t pop() noexcept {
+      std::uint64_t head = head_.load(std::memory_order_acquire);
+
+      for(;;) {
+        std::uint32_t top = static_cast<std::uint32_t>(head & index_mask);
+
+        if(top == 0) {
+          return npos;
+        }
+
+        std::uint64_t next     = slots_[top - 1].next.load(std::memory_order_relaxed);
+        std::uint64_t new_head = (((head >> 32) + 1) << 32) | next;
+
+        if(head_.compare_exchange_weak(head, new_head, std::memory_order_acquire, std::memory_order_acquire)) {
+          return top - 1;
+        }
+      }
+    }
+
+    std::unique_ptr<slot[]>    slots_;
+    std::size_t                capacity_;
+    std::atomic<std::uint64_t> head_ { 0 };
+  };
+}
+
+#endif
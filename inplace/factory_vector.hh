@@ -0,0 +1,244 @@
+#ifndef INCLUDED_INPLACE_FACTORY_VECTOR_HH
+#define INCLUDED_INPLACE_FACTORY_VECTOR_HH
+
+#include "relocation.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace inplace {
+  // Contiguous sequence of factories, i.e. a std::vector<factory_type> that knows about relocation.
+  //
+  // If factory_type is trivially relocatable (see relocation.hh), growing the buffer is a memcpy and erasing
+  // closes the gap with a memmove, instead of moving (or, for types that cannot move, copying) every element
+  // through its operations table and destroying the source. Other factories are moved element by element
+  // like std::vector does; growth then only gives the basic exception guarantee.
+  template<typename factory_type>
+  class factory_vector {
+  private:
+    static constexpr bool relocatable = is_trivially_relocatable_v<factory_type>;
+
+    static_assert(relocatable || std::is_move_constructible_v<factory_type>,
+                  "factory_vector needs factories that can be relocated or moved");
+
+  public:
+    using value_type      = factory_type;
+    using size_type       = std::size_t;
+    using reference       = factory_type &;
+    using const_reference = factory_type const &;
+    using iterator        = factory_type *;
+    using const_iterator  = factory_type const *;
+
+    factory_vector() noexcept = default;
+
+    factory_vector(factory_vector const &other) requires std::is_copy_constructible_v<factory_type> {
+      reserve(other.size());
+
+      try {
+        for(factory_type const &fct : other) {
+          push_back(fct);
+        }
+      } catch(...) {
+        // the destructor does not run for a constructor that throws
+        clear();
+        deallocate(data_, capacity_);
+        throw;
+      }
+    }
+
+    factory_vector(factory_vector &&other) noexcept
+      : data_    (std::exchange(other.data_    , nullptr)),
+        size_    (std::exchange(other.size_    , 0)),
+        capacity_(std::exchange(other.capacity_, 0))
+    { }
+
+    factory_vector &operator=(factory_vector const &other) requires std::is_copy_constructible_v<factory_type> {
+      if(&other != this) {
+        factory_vector(other).swap(*this);
+      }
+
+      return *this;
+    }
+
+    factory_vector &operator=(factory_vector &&other) noexcept {
+      factory_vector(std::move(other)).swap(*this);
+      return *this;
+    }
+
+    ~factory_vector() noexcept {
+      clear();
+      deallocate(data_, capacity_);
+    }
+
+    void swap(factory_vector &other) noexcept {
+      std::swap(data_    , other.data_    );
+      std::swap(size_    , other.size_    );
+      std::swap(capacity_, other.capacity_);
+    }
+
+    friend void swap(factory_vector &lhs, factory_vector &rhs) noexcept {
+      lhs.swap(rhs);
+    }
+
+    size_type size    () const noexcept { return size_; }
+    size_type capacity() const noexcept { return capacity_; }
+    bool      empty   () const noexcept { return size_ == 0; }
+
+    factory_type       *data()       noexcept { return data_; }
+    factory_type const *data() const noexcept { return data_; }
+
+    iterator       begin()       noexcept { return data_; }
+    iterator       end  ()       noexcept { return data_ + size_; }
+    const_iterator begin() const noexcept { return data_; }
+    const_iterator end  () const noexcept { return data_ + size_; }
+
+    reference       operator[](size_type i)       noexcept { return data_[i]; }
+    const_reference operator[](size_type i) const noexcept { return data_[i]; }
+
+    reference       front()       noexcept { return data_[0]; }
+    const_reference front() const noexcept { return data_[0]; }
+    reference       back ()       noexcept { return data_[size_ - 1]; }
+    const_reference back () const noexcept { return data_[size_ - 1]; }
+
+    void reserve(size_type n) {
+      if(n > capacity_) {
+        factory_type *mem = allocate(n);
+
+        try {
+          relocate_into(mem);
+        } catch(...) {
+          deallocate(mem, n);
+          throw;
+        }
+
+        deallocate(data_, capacity_);
+
+        data_     = mem;
+        capacity_ = n;
+      }
+    }
+
+    // Appends a factory holding a T constructed from args and returns the new object. If the construction
+    // throws, the vector is unchanged.
+    template<typename T, typename... Args>
+    auto *emplace_back(Args&&... args) {
+      return append([&](void *mem) {
+          return new(mem) factory_type([&](factory_type &fct) { fct.template construct<T>(std::forward<Args>(args)...); });
+        })->get_ptr();
+    }
+
+    factory_type &push_back(factory_type const &fct) {
+      return *append([&](void *mem) { return new(mem) factory_type(fct); });
+    }
+
+    factory_type &push_back(factory_type &&fct) {
+      return *append([&](void *mem) { return new(mem) factory_type(std::move(fct)); });
+    }
+
+    void pop_back() noexcept {
+      --size_;
+      data_[size_].~factory_type();
+    }
+
+    iterator erase(const_iterator pos) {
+      return erase(pos, pos + 1);
+    }
+
+    // Removes [first, last); the elements behind it keep their order.
+    iterator erase(const_iterator first, const_iterator last) {
+      factory_type *gap  = data_ + (first - data_);
+      factory_type *tail = data_ + (last  - data_);
+      size_type     n    = static_cast<size_type>(tail - gap);
+
+      if(n != 0) {
+        if constexpr(relocatable) {
+          std::destroy(gap, tail);
+          std::memmove(static_cast<void *>(gap), static_cast<void const *>(tail), sizeof(factory_type) * static_cast<size_type>(end() - tail));
+        } else {
+          std::move(tail, end(), gap);
+          std::destroy(end() - n, end());
+        }
+
+        size_ -= n;
+      }
+
+      return gap;
+    }
+
+    void clear() noexcept {
+      std::destroy(begin(), end());
+      size_ = 0;
+    }
+
+  private:
+    // Constructs a new last element with init(mem). When the buffer has to grow, the new element is created
+    // in the new buffer before the old elements move, so init may refer to elements of this vector.
+    template<typename F>
+    factory_type *append(F &&init) {
+      factory_type *result;
+
+      if(size_ == capacity_) {
+        size_type     new_capacity = capacity_ == 0 ? 4 : 2 * capacity_;
+        factory_type *mem          = allocate(new_capacity);
+
+        try {
+          result = init(mem + size_);
+        } catch(...) {
+          deallocate(mem, new_capacity);
+          throw;
+        }
+
+        try {
+          relocate_into(mem);
+        } catch(...) {
+          result->~factory_type();
+          deallocate(mem, new_capacity);
+          throw;
+        }
+
+        deallocate(data_, capacity_);
+
+        data_     = mem;
+        capacity_ = new_capacity;
+      } else {
+        result = init(data_ + size_);
+      }
+
+      ++size_;
+      return result;
+    }
+
+    // Moves all elements to the uninitialized memory at mem, after which the old buffer holds no objects.
+    void relocate_into(factory_type *mem) {
+      if constexpr(relocatable) {
+        if(size_ != 0) {
+          std::memcpy(static_cast<void *>(mem), static_cast<void const *>(data_), sizeof(factory_type) * size_);
+        }
+      } else {
+        std::uninitialized_move(begin(), end(), mem);
+        std::destroy(begin(), end());
+      }
+    }
+
+    static factory_type *allocate(size_type n) {
+      return std::allocator<factory_type>().allocate(n);
+    }
+
+    static void deallocate(factory_type *p, size_type n) noexcept {
+      if(p != nullptr) {
+        std::allocator<factory_type>().deallocate(p, n);
+      }
+    }
+
+    factory_type *data_     = nullptr;
+    size_type     size_     = 0;
+    size_type     capacity_ = 0;
+  };
+}
+
+#endif
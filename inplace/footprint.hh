@@ -0,0 +1,77 @@
+#ifndef INCLUDED_INPLACE_FOOTPRINT_HH
+#define INCLUDED_INPLACE_FOOTPRINT_HH
+
+#include "factory.hh"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <type_traits>
+
+namespace inplace {
+  // Compile-time report of the memory a factory type takes, e.g. for
+  //
+  //   static_assert(footprint<rule_factory>::factory_size <= 64);
+  //
+  // in a build that should catch growth of the largest type. See max_size in storage_policy.hh to limit
+  // the size of every inline type instead.
+  template<typename factory_type>
+  struct footprint;
+
+  template<typename storage_policy, typename base_type, typename... possible_types>
+  struct footprint<basic_factory<storage_policy, base_type, possible_types...>> {
+    using factory_type = basic_factory<storage_policy, base_type, possible_types...>;
+
+    struct type_footprint {
+      std::size_t size;     // sizeof the type
+      std::size_t align;    // alignof the type
+      bool        spilled;  // stored out of line by the storage policy
+      std::size_t slot;     // bytes of the storage it uses: its size, or a pointer's if it is spilled
+      std::size_t wasted;   // storage bytes it leaves unused, compared with the largest slot
+    };
+
+  private:
+    template<typename T>
+    static constexpr bool spills = storage_policy::template spill<T>;
+
+    template<typename T>
+    using slot_type = std::conditional_t<spills<T>, void *, T>;
+
+  public:
+    static constexpr std::size_t factory_size  = sizeof (factory_type);
+    static constexpr std::size_t factory_align = alignof(factory_type);
+
+    // The inline storage, i.e. the largest slot rounded up to the strictest alignment.
+    static constexpr std::size_t storage_size = sizeof(detail::variadic_union<slot_type<possible_types>...>);
+
+    // Bookkeeping next to the storage: the operations table pointer.
+    static constexpr std::size_t ops_size = sizeof(detail::type_ops<factory_type> const *);
+
+    // Everything besides the storage, including padding.
+    static constexpr std::size_t overhead = factory_size - storage_size;
+
+    // One entry per possible type, in the order of possible_types.
+    static constexpr std::array<type_footprint, sizeof...(possible_types)> types = {
+      type_footprint {
+        sizeof (possible_types),
+        alignof(possible_types),
+        spills<possible_types>,
+        sizeof(slot_type<possible_types>),
+        storage_size - sizeof(slot_type<possible_types>)
+      }...
+    };
+
+    template<typename T>
+    requires std::disjunction_v<std::is_same<T, possible_types>...>
+    static constexpr type_footprint of = types[detail::index_of<T, possible_types...>];
+
+    // Position of the type that determines the storage size, the first one if there are several.
+    static constexpr std::size_t largest_index = [] {
+      auto it = std::max_element(types.begin(), types.end(),
+                                 [](type_footprint const &lhs, type_footprint const &rhs) { return lhs.slot < rhs.slot; });
+      return static_cast<std::size_t>(it - types.begin());
+    }();
+  };
+}
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef INCLUDED_INPLACE_HARDWARE_HH
+#define INCLUDED_INPLACE_HARDWARE_HH
+
+#include <cstddef>
+
+namespace inplace {
+  namespace detail {
+    // Alignment that keeps independently written data off each other's cache lines.
+    inline constexpr std::size_t cache_line_size = 64;
+
+    // Spin-wait hint for the processor.
+    inline void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#elif defined(__aarch64__)
+      asm volatile("yield");
+#endif
+    }
+  }
+}
+
+#endif
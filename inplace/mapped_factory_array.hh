@@ -0,0 +1,266 @@
+#ifndef INCLUDED_INPLACE_MAPPED_FACTORY_ARRAY_HH
+#define INCLUDED_INPLACE_MAPPED_FACTORY_ARRAY_HH
+
+#include "archive.hh"
+#include "factory.hh"
+#include "type_dispatch.hh"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <ranges>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace inplace {
+  // Read-only array of factories in a file, for large tables that would take long to build at every start.
+  //
+  // save() writes the factories once; open() maps the file and the objects are used right where they are in
+  // the mapping, so the cost of opening is independent of the number of objects and pages are only read
+  // when they are touched. Every slot holds the type index of its object (see basic_factory::index()) and
+  // the object's bytes.
+  //
+  // A vptr or any other pointer would be meaningless in another process, so the possible types have to be
+  // trivially copyable. The base_type subobject is found through the type index, like visit() does, since
+  // the file cannot hold anything that is only known at runtime. Opening checks a fingerprint of the type
+  // list, so the file must be read by a program with the same types.
+  template<typename base_type, std::derived_from<base_type>... possible_types>
+  class mapped_factory_array {
+    static_assert(sizeof...(possible_types) > 0, "possible_types is empty");
+    static_assert((std::is_trivially_copyable_v<possible_types> && ...),
+                  "objects in a mapped file must be trivially copyable");
+
+  public:
+    using factory_type = factory<base_type, possible_types...>;
+
+    static constexpr std::size_t npos = factory_type::npos;
+
+  private:
+    static constexpr std::uint64_t magic = 0x696e706c61636532; // "inplace2"
+    static constexpr std::uint32_t empty_index = UINT32_MAX;
+
+    struct file_header {
+      std::uint64_t magic;
+      std::uint64_t fingerprint;
+      std::uint64_t count;
+      std::uint64_t slot_size;
+    };
+
+    struct slot {
+      std::uint32_t index;  // empty_index for an empty factory
+
+      alignas(possible_types...)
+      std::byte storage[std::max({ sizeof(possible_types)... })];
+    };
+
+    static constexpr std::size_t slots_offset = (sizeof(file_header) + alignof(slot) - 1) / alignof(slot) * alignof(slot);
+
+  public:
+    // Writes factories to a new file at path, replacing an existing one.
+    template<std::ranges::sized_range Range>
+    requires std::same_as<std::ranges::range_value_t<Range>, factory_type>
+    static void save(char const *path, Range const &factories) {
+      int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+      if(fd == -1) {
+        throw std::system_error(errno, std::generic_category(), "open");
+      }
+
+      try {
+        fd_writer out(fd);
+
+        file_header header = { magic, fingerprint(), std::ranges::size(factories), sizeof(slot) };
+        std::byte   head[slots_offset] = { };
+
+        std::memcpy(head, &header, sizeof header);
+        out.write(head, sizeof head);
+
+        for(factory_type const &fct : factories) {
+          // no stray bytes from the stack in the file
+          slot s;
+          std::memset(&s, 0, sizeof s);
+          s.index = empty_index;
+
+          if(fct) {
+            s.index = static_cast<std::uint32_t>(fct.index());
+            fct.visit([&](auto const &obj) { std::memcpy(s.storage, &obj, sizeof(obj)); });
+          }
+
+          out.write(&s, sizeof s);
+        }
+
+        out.flush();
+      } catch(...) {
+        ::close(fd);
+        throw;
+      }
+
+      if(::close(fd) == -1) {
+        throw std::system_error(errno, std::generic_category(), "close");
+      }
+    }
+
+    // Maps a file written by save().
+    static mapped_factory_array open(char const *path) {
+      int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+
+      if(fd == -1) {
+        throw std::system_error(errno, std::generic_category(), "open");
+      }
+
+      struct stat st;
+
+      if(::fstat(fd, &st) == -1) {
+        int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), "fstat");
+      }
+
+      std::size_t size    = static_cast<std::size_t>(st.st_size);
+      void       *mapping = size >= slots_offset ? ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : nullptr;
+      int         err     = errno;
+
+      // the mapping keeps the file open
+      ::close(fd);
+
+      if(mapping == MAP_FAILED) {
+        throw std::system_error(err, std::generic_category(), "mmap");
+      }
+
+      file_header const *header = static_cast<file_header const *>(mapping);
+
+      if(header == nullptr
+         || header->magic != magic
+         || header->fingerprint != fingerprint()
+         || header->slot_size != sizeof(slot)
+         || header->count != (size - slots_offset) / sizeof(slot)
+         || (size - slots_offset) % sizeof(slot) != 0)
+      {
+        if(mapping != nullptr) {
+          ::munmap(mapping, size);
+        }
+
+        throw std::runtime_error("mapped_factory_array: not a file for this type list");
+      }
+
+      return mapped_factory_array(mapping, size);
+    }
+
+    mapped_factory_array(mapped_factory_array &&other) noexcept
+      : mapping_(std::exchange(other.mapping_, nullptr)),
+        size_   (other.size_),
+        slots_  (other.slots_),
+        count_  (other.count_)
+    { }
+
+    mapped_factory_array(mapped_factory_array const &) = delete;
+    mapped_factory_array &operator=(mapped_factory_array const &) = delete;
+    mapped_factory_array &operator=(mapped_factory_array &&) = delete;
+
+    ~mapped_factory_array() noexcept {
+      if(mapping_ != nullptr) {
+        ::munmap(mapping_, size_);
+      }
+    }
+
+    std::size_t size() const noexcept { return count_; }
+    bool       empty() const noexcept { return count_ == 0; }
+
+    // Type index of the i-th object, npos for an empty slot.
+    std::size_t index(std::size_t i) const {
+      std::uint32_t index = slots_[i].index;
+
+      if(index == empty_index) {
+        return npos;
+      }
+
+      if(index >= sizeof...(possible_types)) {
+        throw std::runtime_error("mapped_factory_array: bad type index in slot");
+      }
+
+      return index;
+    }
+
+    // The base_type subobject of the i-th object, nullptr for an empty slot.
+    base_type const *get_ptr(std::size_t i) const {
+      return index(i) == npos ? nullptr : &visit(i, [](base_type const &obj) -> base_type const & { return obj; });
+    }
+
+    base_type const &operator[](std::size_t i) const {
+      assert(get_ptr(i) != nullptr);
+      return *get_ptr(i);
+    }
+
+    // The i-th object as its concrete type if that is T, nullptr otherwise.
+    template<typename T>
+    requires std::disjunction_v<std::is_same<T, possible_types>...>
+    T const *get_if(std::size_t i) const {
+      return index(i) == detail::index_of<T, possible_types...> ? object<T>(i) : nullptr;
+    }
+
+    // Calls f with the i-th object as its concrete type. The slot must not be empty.
+    template<typename F>
+    decltype(auto) visit(std::size_t i, F &&f) const {
+      return visit<detail::visit_result_t<F, possible_types const &...>>(i, std::forward<F>(f));
+    }
+
+    template<typename R, typename F>
+    R visit(std::size_t i, F &&f) const {
+      std::size_t type = index(i);
+      assert(type != npos);
+
+      return detail::dispatch_index<sizeof...(possible_types), R>(type, [&](auto t) -> R {
+          using T = detail::type_at<decltype(t)::value, possible_types...>;
+
+          return detail::invoke_r<R>(std::forward<F>(f), *object<T>(i));
+        });
+    }
+
+    // A copy of the i-th object in a factory, e.g. to modify it.
+    factory_type load(std::size_t i) const {
+      factory_type result;
+
+      if(index(i) != npos) {
+        visit(i, [&]<typename T>(T const &obj) { result.template construct<T>(obj); });
+      }
+
+      return result;
+    }
+
+  private:
+    mapped_factory_array(void *mapping, std::size_t size) noexcept
+      : mapping_(mapping),
+        size_   (size),
+        slots_  (std::launder(reinterpret_cast<slot const *>(static_cast<std::byte const *>(mapping) + slots_offset))),
+        count_  ((size - slots_offset) / sizeof(slot))
+    { }
+
+    template<typename T>
+    T const *object(std::size_t i) const noexcept {
+      return std::launder(reinterpret_cast<T const *>(slots_[i].storage));
+    }
+
+    static std::uint64_t fingerprint() noexcept {
+      return detail::type_list_fingerprint<possible_types...>();
+    }
+
+    void        *mapping_;
+    std::size_t  size_;
+    slot const  *slots_;
+    std::size_t  count_;
+  };
+}
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef INCLUDED_INPLACE_MESSAGE_RING_HH
+#define INCLUDED_INPLACE_MESSAGE_RING_HH
+
+#include "factory.hh"
+#include "hardware.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace inplace {
+  // Bounded, lock-free multi-producer multi-consumer queue of polymorphic messages.
+  //
+  // Every slot of the ring is a factory, and messages are constructed right in it and handed to the consumer
+  // there, so passing a message neither allocates nor copies or moves it. That also means the possible types
+  // need not be copyable or movable at all.
+  //
+  // The ring is the bounded queue by Dmitry Vyukov: every slot has a sequence number that tells producers
+  // whether the slot is free for the current lap and consumers whether it holds a message for it. Producers and
+  // consumers each claim slots with a CAS on their own position counter.
+  template<typename base_type, std::derived_from<base_type>... possible_types>
+  class message_ring {
+  public:
+    using factory_type = factory<base_type, possible_types...>;
+
+    // capacity is rounded up to a power of two.
+    explicit message_ring(std::size_t capacity)
+      : mask_ (std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1),
+        slots_(std::make_unique<slot[]>(mask_ + 1))
+    {
+      for(std::size_t i = 0; i <= mask_; ++i) {
+        slots_[i].seq.store(i, std::memory_order_relaxed);
+      }
+    }
+
+    message_ring(message_ring const &) = delete;
+    message_ring &operator=(message_ring const &) = delete;
+
+    std::size_t capacity() const noexcept { return mask_ + 1; }
+
+    // Constructs a T message in the next free slot. Returns false if the ring is full.
+    //
+    // If the constructor throws, the claimed slot is published empty and consumers skip it.
+    template<typename T, typename... Args>
+    bool try_emplace(Args&&... args) {
+      std::size_t pos  = enqueue_pos_.load(std::memory_order_relaxed);
+      slot       *s;
+
+      for(;;) {
+        s = &slots_[pos & mask_];
+
+        std::size_t    seq  = s->seq.load(std::memory_order_acquire);
+        std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq - pos);
+
+        if(diff == 0) {
+          if(enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+            break;
+          }
+        } else if(diff < 0) {
+          return false;
+        } else {
+          pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+      }
+
+      publish_guard guard { s, pos + 1 };
+      s->fct.template construct<T>(std::forward<Args>(args)...);
+
+      return true;
+    }
+
+    // Takes the oldest message and calls f with it, as factory_type& if f accepts that or as base_type&
+    // otherwise. The message is destroyed afterwards, even if f throws. Returns false if the ring is empty.
+    template<typename F>
+    bool try_consume(F &&f) {
+      for(;;) {
+        std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        slot       *s;
+
+        for(;;) {
+          s = &slots_[pos & mask_];
+
+          std::size_t    seq  = s->seq.load(std::memory_order_acquire);
+          std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+
+          if(diff == 0) {
+            if(dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+              break;
+            }
+          } else if(diff < 0) {
+            return false;
+          } else {
+            pos = dequeue_pos_.load(std::memory_order_relaxed);
+          }
+        }
+
+        release_guard guard { s, pos + mask_ + 1 };
+
+        if(s->fct) {
+          if constexpr(std::invocable<F&, factory_type &>) {
+            f(s->fct);
+          } else {
+            f(*s->fct);
+          }
+
+          return true;
+        }
+      }
+    }
+
+  private:
+    struct alignas(detail::cache_line_size) slot {
+      std::atomic<std::size_t> seq { 0 };
+      factory_type             fct;
+    };
+
+    // hands a slot to the consumers when the message is constructed, or failed to be
+    struct publish_guard {
+      slot        *s;
+      std::size_t  seq;
+
+      ~publish_guard() { s->seq.store(seq, std::memory_order_release); }
+    };
+
+    // hands a slot back to the producers once the message is consumed
+    struct release_guard {
+      slot        *s;
+      std::size_t  seq;
+
+      ~release_guard() {
+        s->fct.clear();
+        s->seq.store(seq, std::memory_order_release);
+      }
+    };
+
+    std::size_t             mask_;
+    std::unique_ptr<slot[]> slots_;
+
+    alignas(detail::cache_line_size) std::atomic<std::size_t> enqueue_pos_ { 0 };
+    alignas(detail::cache_line_size) std::atomic<std::size_t> dequeue_pos_ { 0 };
+  };
+}
+
+#endif
@@ -0,0 +1,205 @@
+#ifndef INCLUDED_INPLACE_POLY_HH
+#define INCLUDED_INPLACE_POLY_HH
+
+#include "copy_move_semantics.hh"
+#include "factory.hh"
+
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace inplace {
+  // In-place holder for an open set of types: any type derived from base_type that fits into size bytes
+  // with at most align alignment. Unlike factory, the possible types do not have to be listed up front,
+  // so adding a derived type does not touch the declaration of the holder.
+  //
+  // Since the types are not known, the copy/move semantics have to be: enable_copy and enable_move decide
+  // what poly offers, and construct<T> only accepts types that support it under the same rules as factory
+  // (a type that only supports copy can be moved by copying it).
+  template<typename base_type,
+           std::size_t size,
+           std::size_t align = alignof(std::max_align_t),
+           bool enable_copy = true,
+           bool enable_move = true>
+  class poly {
+  private:
+    template<typename T>
+    static constexpr bool allowed_type = std::derived_from<T, base_type>;
+
+  public:
+    poly() noexcept = default;
+
+    template<typename T, typename... Args>
+    explicit poly(std::in_place_type_t<T>, Args&&... args) {
+      construct<T>(std::forward<Args>(args)...);
+    }
+
+    poly(poly const &other) requires enable_copy {
+      *this = other;
+    }
+
+    poly(poly &&other) requires (enable_copy || enable_move) {
+      *this = std::move(other);
+    }
+
+    poly &operator=(poly const &other) requires enable_copy {
+      if(&other != this) {
+        if(other.is_initialized() && ops_ == other.ops_ && ops_->copy_assign != nullptr) {
+          ops_->copy_assign(other, *this);
+        } else if(other.is_initialized()) {
+          other.ops_->copy(other, *this);
+        } else {
+          clear();
+        }
+      }
+
+      return *this;
+    }
+
+    poly &operator=(poly &&other) requires (enable_copy || enable_move) {
+      if(&other != this) {
+        if(other.is_initialized() && ops_ == other.ops_ && ops_->move_assign != nullptr) {
+          ops_->move_assign(std::move(other), *this);
+          other.clear();
+        } else {
+          clear();
+
+          if(other.is_initialized()) {
+            other.ops_->relocate(other, *this);
+          }
+        }
+      }
+
+      return *this;
+    }
+
+    ~poly() noexcept {
+      clear();
+    }
+
+    void clear() noexcept {
+      if(is_initialized()) {
+        ops_->destroy(*this);
+        ops_ = nullptr;
+      }
+    }
+
+    void swap(poly &other) requires (enable_copy || enable_move) {
+      if(ops_ == other.ops_ && is_initialized() && ops_->swap != nullptr) {
+        ops_->swap(*this, other);
+      } else if(&other != this) {
+        poly tmp(std::move(other));
+        other = std::move(*this);
+        *this = std::move(tmp);
+      }
+    }
+
+    friend void swap(poly &lhs, poly &rhs) requires (enable_copy || enable_move) {
+      lhs.swap(rhs);
+    }
+
+    template<typename T, typename... Args>
+    requires allowed_type<T>
+    base_type *construct(Args&&... args) {
+      using cpmov = detail::copy_move_traits<T>;
+
+      static_assert(sizeof(T) <= size, "type does not fit into the poly's storage");
+      static_assert(alignof(T) <= align, "type is overaligned for the poly's storage");
+      static_assert(!enable_copy || cpmov::offer_copy, "poly supports copy, but the type is not copy constructible");
+      static_assert(!enable_move || cpmov::offer_move, "poly supports move, but the type is neither move nor copy constructible");
+
+      clear();
+      detail::record_base_offset<base_type>(ops_for<T>::table, detail::construct_in<T>(storage(), std::forward<Args>(args)...));
+      ops_ = &ops_for<T>::table;
+
+      return get_ptr();
+    }
+
+    // Same as factory::emplace_or_assign.
+    template<typename T, typename... Args>
+    requires allowed_type<T>
+    base_type *emplace_or_assign(Args&&... args) {
+      if constexpr(sizeof...(Args) == 1 && (std::is_assignable_v<T&, Args> && ...)) {
+        if(T *obj = get_if<T>()) {
+          ((*obj = std::forward<Args>(args)), ...);
+          return get_ptr();
+        }
+      }
+
+      return construct<T>(std::forward<Args>(args)...);
+    }
+
+    bool is_initialized() const noexcept {
+      return ops_ != nullptr;
+    }
+
+    base_type *get_ptr() const noexcept {
+      return is_initialized() ? detail::base_of<base_type>(*ops_, storage()) : nullptr;
+    }
+
+    base_type &get() const noexcept {
+      assert(get_ptr() != nullptr);
+      return *get_ptr();
+    }
+
+    base_type *operator->() const noexcept {
+      return get_ptr();
+    }
+
+    base_type &operator*() const noexcept {
+      return get();
+    }
+
+    explicit operator bool() const noexcept {
+      return is_initialized();
+    }
+
+    // The held object as its concrete type if that is T, nullptr otherwise.
+    template<typename T>
+    requires allowed_type<T>
+    T *get_if() noexcept {
+      return ops_ == &ops_for<T>::table ? object<T>() : nullptr;
+    }
+
+    template<typename T>
+    requires allowed_type<T>
+    T const *get_if() const noexcept {
+      return ops_ == &ops_for<T>::table ? object<T>() : nullptr;
+    }
+
+  private:
+    template<typename, typename, std::size_t, bool, bool, bool> friend struct detail::type_ops_impl;
+
+    // the operations table's index is meaningless for an open set of types.
+    template<typename T>
+    using ops_for = detail::type_ops_impl<poly, T, static_cast<std::size_t>(-1), enable_copy, enable_copy || enable_move, false>;
+
+    template<typename T>
+    void destroy() noexcept {
+      object<T>()->~T();
+    }
+
+    template<typename T>
+    T *object() noexcept {
+      return static_cast<T *>(storage());
+    }
+
+    template<typename T>
+    T const *object() const noexcept {
+      return static_cast<T const *>(storage());
+    }
+
+    void       *storage()       noexcept { return storage_; }
+    void const *storage() const noexcept { return storage_; }
+
+    alignas(align)
+    std::byte storage_[size];
+
+    // operations table of the type currently held, nullptr when empty.
+    detail::type_ops<poly> const *ops_ = nullptr;
+  };
+}
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef INCLUDED_INPLACE_POLY_COLLECTION_HH
+#define INCLUDED_INPLACE_POLY_COLLECTION_HH
+
+#include <concepts>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace inplace {
+  // Type-partitioned container for a closed set of types, i.e. a structure of arrays to factory's array of
+  // structures.
+  //
+  // Objects of each possible type live in their own contiguous segment with a stride of sizeof(T) instead of
+  // the size of the largest type. Iteration walks one segment after the other and hands out the concrete
+  // types, so the calls in there are direct (and inlinable for final overrides) rather than virtual calls
+  // that jump between types from one element to the next. The order of objects of different types is not
+  // preserved.
+  //
+  // Segments are std::vectors, so the possible types have to be copy or move constructible.
+  template<typename base_type, std::derived_from<base_type>... possible_types>
+  class poly_collection {
+    static_assert(sizeof...(possible_types) > 0, "possible_types is empty");
+
+  private:
+    template<typename T>
+    static constexpr bool allowed_type = std::disjunction_v<std::is_same<T, possible_types>...>;
+
+  public:
+    template<typename T, typename... Args>
+    requires allowed_type<T>
+    T &emplace(Args&&... args) {
+      return segment<T>().emplace_back(std::forward<Args>(args)...);
+    }
+
+    template<typename T>
+    requires allowed_type<T>
+    std::vector<T> &segment() noexcept {
+      return std::get<std::vector<T>>(segments_);
+    }
+
+    template<typename T>
+    requires allowed_type<T>
+    std::vector<T> const &segment() const noexcept {
+      return std::get<std::vector<T>>(segments_);
+    }
+
+    template<typename T>
+    requires allowed_type<T>
+    void reserve(std::size_t n) {
+      segment<T>().reserve(n);
+    }
+
+    std::size_t size() const noexcept {
+      return (segment<possible_types>().size() + ...);
+    }
+
+    bool empty() const noexcept {
+      return (segment<possible_types>().empty() && ...);
+    }
+
+    void clear() noexcept {
+      (segment<possible_types>().clear(), ...);
+    }
+
+    // Calls f with every object as its concrete type, segment by segment in the order of possible_types.
+    template<typename F>
+    void for_each(F &&f) {
+      (for_each_in(segment<possible_types>(), f), ...);
+    }
+
+    template<typename F>
+    void for_each(F &&f) const {
+      (for_each_in(segment<possible_types>(), f), ...);
+    }
+
+  private:
+    template<typename segment_type, typename F>
+    static void for_each_in(segment_type &seg, F &f) {
+      for(auto &obj : seg) {
+        f(obj);
+      }
+    }
+
+    std::tuple<std::vector<possible_types>...> segments_;
+  };
+}
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef INCLUDED_INPLACE_POLY_STACK_HH
+#define INCLUDED_INPLACE_POLY_STACK_HH
+
+#include "copy_move_semantics.hh"
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace inplace {
+  // Bump arena for objects derived from base_type, e.g. scratch objects that live as long as one request.
+  //
+  // Objects are placed one after another at their own size and alignment in chunks of memory, and all of them
+  // are destroyed at once by release(), in reverse order of construction. There is no way to free a single
+  // object. When a chunk is full, the next one is allocated with chunk_size bytes, or more for an object that
+  // does not fit into that. release() frees all chunks but the first, so a stack that is reused for requests
+  // which fit into one chunk does not allocate again after the first of them.
+  //
+  // Objects that need their destructor run are preceded by a small record (destructor and link to the
+  // previous record), so the list of destructors lives in the arena as well. Trivially destructible objects
+  // get no record and cost nothing on release().
+  template<typename base_type>
+  class poly_stack {
+  public:
+    static constexpr std::size_t default_chunk_size = 4096;
+
+    explicit poly_stack(std::size_t chunk_size = default_chunk_size) noexcept
+      : chunk_size_(chunk_size)
+    { }
+
+    poly_stack(poly_stack const &) = delete;
+    poly_stack &operator=(poly_stack const &) = delete;
+
+    ~poly_stack() noexcept {
+      release();
+
+      if(first_ != nullptr) {
+        free_chunk(first_);
+      }
+    }
+
+    // Constructs a T in the arena. The pointer converts to base_type* like any other, i.e. with the right
+    // adjustment for multiple inheritance.
+    template<std::derived_from<base_type> T, typename... Args>
+    T *emplace(Args&&... args) {
+      constexpr bool        needs_record = !std::is_trivially_destructible_v<T>;
+      constexpr std::size_t offset       = needs_record ? object_offset<T>() : 0;
+      constexpr std::size_t align        = std::max(alignof(T), needs_record ? alignof(dtor_record) : 1);
+
+      std::byte *start  = reserve(offset + sizeof(T), align);
+      std::byte *object = start + offset;
+
+      T *obj = detail::construct_in<T>(object, std::forward<Args>(args)...);
+
+      if constexpr(needs_record) {
+        dtor_record *record = new(start) dtor_record { &destroy<T>, last_record_ };
+        last_record_ = record;
+      }
+
+      pos_ = object + sizeof(T);
+      return obj;
+    }
+
+    // Destroys all objects, newest first, and makes the memory available again. The first chunk is kept.
+    void release() noexcept {
+      for(dtor_record *r = last_record_; r != nullptr; r = r->prev) {
+        r->destroy(r);
+      }
+
+      last_record_ = nullptr;
+
+      if(first_ != nullptr) {
+        while(first_->next != nullptr) {
+          chunk *next = first_->next->next;
+          free_chunk(first_->next);
+          first_->next = next;
+        }
+
+        current_ = first_;
+        pos_     = first_->begin();
+      }
+    }
+
+  private:
+    struct dtor_record {
+      void        (*destroy)(dtor_record *) noexcept;
+      dtor_record  *prev;
+    };
+
+    struct alignas(std::max_align_t) chunk {
+      chunk       *next;
+      std::size_t  size;
+
+      std::byte *begin() noexcept { return reinterpret_cast<std::byte *>(this + 1); }
+      std::byte *end  () noexcept { return begin() + size; }
+    };
+
+    static std::byte *align_up(std::byte *p, std::size_t align) noexcept {
+      std::uintptr_t addr = reinterpret_cast<std::uintptr_t>(p);
+      return p + ((align - addr % align) % align);
+    }
+
+    // Distance from a record to its object. The record is aligned for both, so the object is at the first
+    // multiple of alignof(T) after it.
+    template<typename T>
+    static constexpr std::size_t object_offset() noexcept {
+      return (sizeof(dtor_record) + alignof(T) - 1) / alignof(T) * alignof(T);
+    }
+
+    template<typename T>
+    static void destroy(dtor_record *record) noexcept {
+      std::byte *object = reinterpret_cast<std::byte *>(record) + object_offset<T>();
+      std::launder(reinterpret_cast<T *>(object))->~T();
+    }
+
+    // Start of size bytes, with room to align them to align, in the current chunk or a new one. Does not
+    // move pos_, so nothing is lost if the construction throws.
+    std::byte *reserve(std::size_t size, std::size_t align) {
+      if(current_ != nullptr) {
+        std::byte *start = align_up(pos_, align);
+
+        if(start + size <= current_->end()) {
+          return start;
+        }
+      }
+
+      chunk *c = new_chunk(std::max(chunk_size_, size + align));
+
+      if(current_ == nullptr) {
+        first_ = c;
+      } else {
+        current_->next = c;
+      }
+
+      current_ = c;
+      pos_     = c->begin();
+
+      return align_up(pos_, align);
+    }
+
+    static chunk *new_chunk(std::size_t size) {
+      void *mem = ::operator new(sizeof(chunk) + size);
+      return new(mem) chunk { nullptr, size };
+    }
+
+    static void free_chunk(chunk *c) noexcept {
+      ::operator delete(c);
+    }
+
+    std::size_t  chunk_size_;
+    chunk       *first_       = nullptr;
+    chunk       *current_     = nullptr;
+    std::byte   *pos_         = nullptr;
+    dtor_record *last_record_ = nullptr;
+  };
+}
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef INCLUDED_INPLACE_RELOCATION_HH
+#define INCLUDED_INPLACE_RELOCATION_HH
+
+#include <type_traits>
+
+namespace inplace {
+  // Trivially relocatable: an object can be moved to another address by copying its bytes, after which the
+  // old copy is considered gone without running its destructor. Trivially copyable types are; other types
+  // opt in by specializing this trait, e.g. types that only own heap memory through std::unique_ptr,
+  // std::vector or std::shared_ptr. Types that point into themselves (or are pointed to by others) must not.
+  template<typename T>
+  struct is_trivially_relocatable : std::is_trivially_copyable<T> { };
+
+  template<typename T>
+  inline constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+}
+
+#endif
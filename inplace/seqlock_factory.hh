@@ -0,0 +1,106 @@
+#ifndef INCLUDED_INPLACE_SEQLOCK_FACTORY_HH
+#define INCLUDED_INPLACE_SEQLOCK_FACTORY_HH
+
+#include "hardware.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+namespace inplace {
+  // Factory shared between one writer and any number of readers through a sequence lock.
+  //
+  // The writer replaces the whole factory with construct<T>() or store(); readers take a copy of it with
+  // load(), optimistically, and retry if a write happened while they were copying. Readers never write to
+  // shared memory, so they do not contend with each other, and there is nothing to reclaim because readers
+  // only ever work on their own copies.
+  //
+  // This needs a trivially copyable factory, i.e. one whose possible types are all trivially copyable and
+  // stored inline: those are position-independent and can be copied (and torn) bytewise. The bytes are
+  // copied as relaxed atomic words, so a torn read is not a data race.
+  template<typename factory_type>
+  class seqlock_factory {
+    static_assert(std::is_trivially_copyable_v<factory_type>, "seqlock_factory needs a trivially copyable factory");
+
+  private:
+    using word = std::uint64_t;
+
+    static constexpr std::size_t word_count = (sizeof(factory_type) + sizeof(word) - 1) / sizeof(word);
+
+  public:
+    seqlock_factory() noexcept {
+      write(factory_type());
+    }
+
+    seqlock_factory(seqlock_factory const &) = delete;
+    seqlock_factory &operator=(seqlock_factory const &) = delete;
+
+    // Writer side. Only one thread may write at a time.
+    template<typename T, typename... Args>
+    void construct(Args&&... args) {
+      factory_type fct;
+      fct.template construct<T>(std::forward<Args>(args)...);
+      store(fct);
+    }
+
+    void store(factory_type const &fct) noexcept {
+      std::uint64_t seq = seq_.load(std::memory_order_relaxed);
+
+      seq_.store(seq + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+
+      write(fct);
+
+      seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    void clear() noexcept {
+      store(factory_type());
+    }
+
+    // Reader side: a consistent copy of the factory.
+    factory_type load() const noexcept {
+      word buffer[word_count];
+
+      for(;;) {
+        std::uint64_t seq = seq_.load(std::memory_order_acquire);
+
+        if(seq % 2 == 0) {
+          for(std::size_t i = 0; i < word_count; ++i) {
+            buffer[i] = std::atomic_ref<word>(words_[i]).load(std::memory_order_relaxed);
+          }
+
+          std::atomic_thread_fence(std::memory_order_acquire);
+
+          if(seq_.load(std::memory_order_relaxed) == seq) {
+            break;
+          }
+        }
+
+        detail::cpu_relax();
+      }
+
+      factory_type result;
+      std::memcpy(static_cast<void *>(&result), buffer, sizeof(factory_type));
+      return result;
+    }
+
+  private:
+    void write(factory_type const &fct) noexcept {
+      word buffer[word_count] = { };
+      std::memcpy(buffer, static_cast<void const *>(&fct), sizeof(factory_type));
+
+      for(std::size_t i = 0; i < word_count; ++i) {
+        std::atomic_ref<word>(words_[i]).store(buffer[i], std::memory_order_relaxed);
+      }
+    }
+
+    alignas(detail::cache_line_size) std::atomic<std::uint64_t> seq_ { 0 };
+    mutable word words_[word_count];
+  };
+}
+
+#endif
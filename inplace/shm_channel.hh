@@ -0,0 +1,210 @@
+#ifndef INCLUDED_INPLACE_SHM_CHANNEL_HH
+#define INCLUDED_INPLACE_SHM_CHANNEL_HH
+
+#include "spsc_ring.hh"
+
+#include <atomic>
+#include <cerrno>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace inplace {
+  // Single-producer single-consumer channel between two processes on the same machine, in the record format
+  // of spsc_ring.
+  //
+  // The ring lives in a memfd mapping. One process creates the channel and hands fd() to the other one,
+  // which attaches to it: by fork(), over a unix socket with SCM_RIGHTS, or as /proc/<pid>/fd/<n>. Producers
+  // construct objects right in the shared buffer and the consumer reads them there, so nothing goes through
+  // an encoder. The mapping may be at a different address in each process; it contains no pointers, only
+  // positions, and objects are identified by their index in possible_types.
+  //
+  // An object with a vtable cannot be used from another process (the vptr is only valid in the one that
+  // constructed it), so the possible types have to be trivially copyable and the consumer receives them as
+  // their concrete type, dispatched on the type index. Both sides must use the same type list from the same
+  // binary; attaching checks a fingerprint of it.
+  template<typename base_type, std::derived_from<base_type>... possible_types>
+  class shm_channel {
+    static_assert(sizeof...(possible_types) > 0, "possible_types is empty");
+    static_assert((std::is_trivially_copyable_v<possible_types> && ...),
+                  "objects in shared memory must be trivially copyable");
+    static_assert(std::atomic<std::size_t>::is_always_lock_free, "shared positions need lock-free atomics");
+
+  private:
+    using records_type = detail::spsc_records<possible_types...>;
+
+    template<typename T>
+    static constexpr bool allowed_type = std::disjunction_v<std::is_same<T, possible_types>...>;
+
+    static constexpr std::uint64_t magic = 0x696e706c61636531; // "inplace1"
+
+    struct control_block {
+      std::uint64_t          magic;
+      std::uint64_t          fingerprint;
+      std::uint64_t          capacity;
+      detail::spsc_positions positions;
+    };
+
+    static constexpr std::size_t buffer_offset = (sizeof(control_block) + records_type::granularity - 1)
+                                                 / records_type::granularity * records_type::granularity;
+
+  public:
+    // Creates a channel with a ring of at least capacity bytes, see spsc_ring.
+    static shm_channel create(std::size_t capacity) {
+      capacity = records_type::capacity_for(capacity);
+
+      int fd = ::memfd_create("inplace_shm_channel", MFD_CLOEXEC);
+
+      if(fd == -1) {
+        throw std::system_error(errno, std::generic_category(), "memfd_create");
+      }
+
+      std::size_t size = buffer_offset + capacity;
+
+      if(::ftruncate(fd, static_cast<off_t>(size)) == -1) {
+        int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), "ftruncate");
+      }
+
+      void *mapping = map(fd, size);
+      new(mapping) control_block { magic, fingerprint(), capacity, { } };
+
+      return shm_channel(fd, mapping, size);
+    }
+
+    // Attaches to a channel created by another process. fd is duplicated, so the caller keeps ownership.
+    static shm_channel attach(int fd) {
+      int own_fd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+
+      if(own_fd == -1) {
+        throw std::system_error(errno, std::generic_category(), "fcntl");
+      }
+
+      struct stat st;
+
+      if(::fstat(own_fd, &st) == -1) {
+        int err = errno;
+        ::close(own_fd);
+        throw std::system_error(err, std::generic_category(), "fstat");
+      }
+
+      std::size_t size = static_cast<std::size_t>(st.st_size);
+      void *mapping = size >= sizeof(control_block) ? map(own_fd, size) : nullptr;
+
+      control_block const *control = static_cast<control_block const *>(mapping);
+
+      if(control == nullptr
+         || control->magic != magic
+         || control->fingerprint != fingerprint()
+         || control->capacity != records_type::capacity_for(control->capacity)
+         || buffer_offset + control->capacity != size)
+      {
+        if(mapping != nullptr) {
+          ::munmap(mapping, size);
+        }
+
+        ::close(own_fd);
+        throw std::runtime_error("shm_channel: not a channel for this type list");
+      }
+
+      return shm_channel(own_fd, mapping, size);
+    }
+
+    shm_channel(shm_channel &&other) noexcept
+      : fd_     (std::exchange(other.fd_, -1)),
+        mapping_(std::exchange(other.mapping_, nullptr)),
+        size_   (other.size_),
+        records_(other.records_)
+    { }
+
+    shm_channel(shm_channel const &) = delete;
+    shm_channel &operator=(shm_channel const &) = delete;
+    shm_channel &operator=(shm_channel &&) = delete;
+
+    // Unconsumed objects are trivially destructible and simply stay in the mapping for the other side.
+    ~shm_channel() noexcept {
+      if(mapping_ != nullptr) {
+        ::munmap(mapping_, size_);
+      }
+
+      if(fd_ != -1) {
+        ::close(fd_);
+      }
+    }
+
+    int fd() const noexcept { return fd_; }
+
+    std::size_t capacity() const noexcept { return records_.capacity(); }
+
+    // Producer side, see spsc_ring.
+    template<typename T, typename... Args>
+    requires allowed_type<T>
+    bool try_emplace(Args&&... args) {
+      return records_.template try_emplace<T>(std::forward<Args>(args)...);
+    }
+
+    // Consumer side, see spsc_ring.
+    template<typename F>
+    std::size_t consume(F &&f) {
+      return records_.consume(std::forward<F>(f), std::numeric_limits<std::size_t>::max());
+    }
+
+    template<typename F>
+    std::size_t consume(F &&f, std::size_t max_count) {
+      return records_.consume(std::forward<F>(f), max_count);
+    }
+
+    bool empty() const noexcept {
+      return records_.empty();
+    }
+
+  private:
+    shm_channel(int fd, void *mapping, std::size_t size) noexcept
+      : fd_     (fd),
+        mapping_(mapping),
+        size_   (size),
+        records_(control()->positions,
+                 static_cast<std::byte *>(mapping) + buffer_offset,
+                 static_cast<std::size_t>(control()->capacity))
+    { }
+
+    control_block *control() const noexcept {
+      return std::launder(static_cast<control_block *>(mapping_));
+    }
+
+    static void *map(int fd, std::size_t size) {
+      void *mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+      if(mapping == MAP_FAILED) {
+        int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), "mmap");
+      }
+
+      return mapping;
+    }
+
+    static std::uint64_t fingerprint() noexcept {
+      return detail::type_list_fingerprint<possible_types...>();
+    }
+
+    int          fd_;
+    void        *mapping_;
+    std::size_t  size_;
+    records_type records_;
+  };
+}
+
+#endif
@@ -0,0 +1,237 @@
+#ifndef INCLUDED_INPLACE_SPSC_RING_HH
+#define INCLUDED_INPLACE_SPSC_RING_HH
+
+#include "hardware.hh"
+#include "type_dispatch.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace inplace {
+  namespace detail {
+    // Read and write positions of an SPSC ring, each on its own cache line. The positions only ever grow; the
+    // offset into the buffer is the position modulo its capacity.
+    struct spsc_positions {
+      alignas(cache_line_size) std::atomic<std::size_t> head { 0 };  // written by the producer
+      alignas(cache_line_size) std::atomic<std::size_t> tail { 0 };  // written by the consumer
+    };
+
+    // The record format and the producer and consumer sides of spsc_ring, for a buffer and positions that
+    // live elsewhere. This is shared with shm_channel, which keeps them in shared memory.
+    template<typename... possible_types>
+    class spsc_records {
+    private:
+      struct record_header {
+        std::uint32_t tag;     // index into possible_types, padding_tag for padding
+        std::uint32_t length;  // of the whole record including the header
+      };
+
+      static constexpr std::uint32_t padding_tag = std::numeric_limits<std::uint32_t>::max();
+
+      static constexpr std::size_t round_up(std::size_t n, std::size_t align) {
+        return (n + align - 1) / align * align;
+      }
+
+      template<typename T>
+      static constexpr std::size_t object_offset = round_up(sizeof(record_header), alignof(T));
+
+    public:
+      // Records start at multiples of this, so every object can be aligned at a fixed offset from its header.
+      // It is at least a header, so the padding left before the end of the buffer always holds one.
+      static constexpr std::size_t granularity = std::max({ sizeof(record_header), alignof(possible_types)... });
+
+      template<typename T>
+      static constexpr std::size_t record_size = round_up(object_offset<T> + sizeof(T), granularity);
+
+      // Smallest usable capacity: a power of two that holds twice the largest record. A record that does not
+      // fit before the end of the buffer needs the padding up to the end as well, which is less than its own
+      // size, so every record fits into an empty ring wherever its positions are.
+      static constexpr std::size_t capacity_for(std::size_t capacity) {
+        return std::bit_ceil(std::max({ capacity, 2 * record_size<possible_types>... }));
+      }
+
+      // buffer must be aligned to granularity, capacity as returned by capacity_for.
+      spsc_records(spsc_positions &positions, std::byte *buffer, std::size_t capacity) noexcept
+        : positions_(positions),
+          buffer_   (buffer),
+          capacity_ (capacity),
+          cached_tail_(positions.tail.load(std::memory_order_acquire))
+      { }
+
+      std::size_t capacity() const noexcept { return capacity_; }
+
+      template<typename T, typename... Args>
+      bool try_emplace(Args&&... args) {
+        constexpr std::size_t size = record_size<T>;
+
+        std::size_t head   = positions_.head.load(std::memory_order_relaxed);
+        std::size_t offset = head & (capacity_ - 1);
+        std::size_t pad    = capacity_ - offset < size ? capacity_ - offset : 0;
+
+        if(!has_room(head, pad + size)) {
+          return false;
+        }
+
+        if(pad != 0) {
+          new(buffer_ + offset) record_header { padding_tag, static_cast<std::uint32_t>(pad) };
+          head   += pad;
+          offset  = 0;
+        }
+
+        new(buffer_ + offset + object_offset<T>) T(std::forward<Args>(args)...);
+        new(buffer_ + offset) record_header { static_cast<std::uint32_t>(index_of<T, possible_types...>),
+                                              static_cast<std::uint32_t>(size) };
+
+        positions_.head.store(head + size, std::memory_order_release);
+        return true;
+      }
+
+      template<typename F>
+      std::size_t consume(F &&f, std::size_t max_count) {
+        std::size_t const head = positions_.head.load(std::memory_order_acquire);
+
+        struct release_guard {
+          spsc_positions &positions;
+          std::size_t     tail;
+
+          ~release_guard() { positions.tail.store(tail, std::memory_order_release); }
+        } guard { positions_, positions_.tail.load(std::memory_order_relaxed) };
+
+        std::size_t count = 0;
+
+        while(guard.tail != head && count < max_count) {
+          std::byte           *record = buffer_ + (guard.tail & (capacity_ - 1));
+          record_header const  header = *std::launder(reinterpret_cast<record_header *>(record));
+
+          guard.tail += header.length;
+
+          if(header.tag != padding_tag) {
+            ++count;
+
+            dispatch_index<sizeof...(possible_types), void>(header.tag, [&](auto i) {
+                using T = type_at<decltype(i)::value, possible_types...>;
+
+                T &obj = *std::launder(reinterpret_cast<T *>(record + object_offset<T>));
+                destroy_guard<T> destroy { obj };
+
+                f(obj);
+              });
+          }
+        }
+
+        return count;
+      }
+
+      bool empty() const noexcept {
+        return positions_.head.load(std::memory_order_acquire) == positions_.tail.load(std::memory_order_acquire);
+      }
+
+    private:
+      template<typename T>
+      struct destroy_guard {
+        T &obj;
+        ~destroy_guard() { obj.~T(); }
+      };
+
+      bool has_room(std::size_t head, std::size_t n) noexcept {
+        if(head + n - cached_tail_ > capacity_) {
+          cached_tail_ = positions_.tail.load(std::memory_order_acquire);
+        }
+
+        return head + n - cached_tail_ <= capacity_;
+      }
+
+      spsc_positions &positions_;
+      std::byte      *buffer_;
+      std::size_t     capacity_;
+      std::size_t     cached_tail_;   // producer's view of the tail, refreshed when the ring looks full
+    };
+  }
+
+  // Single-producer single-consumer queue of polymorphic objects packed at their own size.
+  //
+  // Unlike message_ring, whose slots are as large as the largest possible type, every record here takes a
+  // small header (type index and record length) plus sizeof(T), rounded up to the record granularity, so
+  // rings with mostly small and a few large messages hold many more of them. The objects are constructed in
+  // the ring and handed to the consumer in place; they are never copied or moved.
+  //
+  // A record that does not fit into the space left before the end of the buffer is preceded by a padding
+  // record that fills it up, so records are always contiguous. The consumer works through all records that
+  // are available in one go and only then hands the space back, so a burst of small messages costs one
+  // exchange of positions between the threads rather than one per message.
+  template<typename base_type, std::derived_from<base_type>... possible_types>
+  class spsc_ring {
+    static_assert(sizeof...(possible_types) > 0, "possible_types is empty");
+
+  private:
+    using records_type = detail::spsc_records<possible_types...>;
+
+    template<typename T>
+    static constexpr bool allowed_type = std::disjunction_v<std::is_same<T, possible_types>...>;
+
+  public:
+    // capacity is in bytes and rounded up to a power of two that holds at least two of the largest record.
+    explicit spsc_ring(std::size_t capacity)
+      : buffer_ (allocate(records_type::capacity_for(capacity))),
+        records_(positions_, buffer_.get(), records_type::capacity_for(capacity))
+    { }
+
+    spsc_ring(spsc_ring const &) = delete;
+    spsc_ring &operator=(spsc_ring const &) = delete;
+
+    ~spsc_ring() noexcept {
+      consume([](auto &) { });
+    }
+
+    std::size_t capacity() const noexcept { return records_.capacity(); }
+
+    // Producer side: constructs a T at the end of the queue. Returns false if there is not enough room.
+    template<typename T, typename... Args>
+    requires allowed_type<T>
+    bool try_emplace(Args&&... args) {
+      return records_.template try_emplace<T>(std::forward<Args>(args)...);
+    }
+
+    // Consumer side: calls f with every available object as its concrete type, i.e. as T& for the T that
+    // was constructed, and destroys it afterwards. Returns the number of objects. The space is handed back
+    // to the producer once at the end, or when f throws, up to and including the object f threw on.
+    template<typename F>
+    std::size_t consume(F &&f) {
+      return records_.consume(std::forward<F>(f), std::numeric_limits<std::size_t>::max());
+    }
+
+    // Same as above, but stops after max_count objects.
+    template<typename F>
+    std::size_t consume(F &&f, std::size_t max_count) {
+      return records_.consume(std::forward<F>(f), max_count);
+    }
+
+    bool empty() const noexcept {
+      return records_.empty();
+    }
+
+  private:
+    struct buffer_deleter {
+      void operator()(std::byte *p) const noexcept { ::operator delete(p, std::align_val_t(records_type::granularity)); }
+    };
+
+    static std::byte *allocate(std::size_t capacity) {
+      return static_cast<std::byte *>(::operator new(capacity, std::align_val_t(records_type::granularity)));
+    }
+
+    detail::spsc_positions                     positions_;
+    std::unique_ptr<std::byte, buffer_deleter> buffer_;
+    records_type                               records_;
+  };
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef INCLUDED_INPLACE_STORAGE_POLICY_HH
+#define INCLUDED_INPLACE_STORAGE_POLICY_HH
+
+#include <cstddef>
+#include <memory_resource>
+#include <type_traits>
+
+// Storage policies for basic_factory. A policy decides for every possible type whether it is stored inline
+// in the factory or spilled to memory obtained from a std::pmr::memory_resource, in which case the
+// factory's storage only holds a pointer to it.
+//
+// A policy provides
+//
+//   template<typename T> static constexpr bool spill;  // store T out of line
+//   static std::pmr::memory_resource *resource();      // where spilled objects live (only if anything spills)
+
+namespace inplace {
+  // Every possible type is stored inline. This is what factory uses.
+  struct inline_storage {
+    template<typename T>
+    static constexpr bool spill = false;
+  };
+
+  // Resource provider for spill_storage that uses operator new and delete.
+  struct new_delete_resource_provider {
+    static std::pmr::memory_resource *get() noexcept {
+      return std::pmr::new_delete_resource();
+    }
+  };
+
+  // Types larger than threshold bytes are allocated from resource_provider::get(), everything else is stored
+  // inline. The storage of the factory is then sized by the largest inline type, so a few rare, large types
+  // no longer inflate every factory.
+  //
+  // resource_provider::get() must return the same resource for the lifetime of every factory using it.
+  template<std::size_t threshold, typename resource_provider = new_delete_resource_provider>
+  struct spill_storage {
+    template<typename T>
+    static constexpr bool spill = (sizeof(T) > threshold);
+
+    static std::pmr::memory_resource *resource() noexcept {
+      return resource_provider::get();
+    }
+  };
+
+  // Size budget for the types inner_policy stores inline: a factory with a larger inline type does not
+  // compile, so a new member in one derived class cannot silently grow every factory. The error points at
+  // fits<T> for the offending T. Spilled types are not limited.
+  template<std::size_t max_bytes, typename inner_policy = inline_storage>
+  struct max_size {
+    template<typename T>
+    static constexpr bool fits = inner_policy::template spill<T> || sizeof(T) <= max_bytes;
+
+    template<typename T>
+    static constexpr bool checked_spill() {
+      static_assert(fits<T>, "type is larger than the max_size budget of the factory");
+      return inner_policy::template spill<T>;
+    }
+
+    template<typename T>
+    static constexpr bool spill = checked_spill<T>();
+
+    static std::pmr::memory_resource *resource() noexcept requires requires { inner_policy::resource(); } {
+      return inner_policy::resource();
+    }
+  };
+}
+
+#endif
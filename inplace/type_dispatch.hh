@@ -0,0 +1,131 @@
+#ifndef INCLUDED_INPLACE_TYPE_DISPATCH_HH
+#define INCLUDED_INPLACE_TYPE_DISPATCH_HH
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+// Helpers to work with a list of possible types and to dispatch on a runtime index into it.
+//
+// Dispatch is done with a chain of comparisons for small type lists, which the compiler turns into a
+// switch (or a handful of predictable branches) and which keeps the called functions inlinable. Longer
+// lists use a table of function pointers.
+
+namespace inplace {
+  namespace detail {
+    // Position of T in Ts..., sizeof...(Ts) if it is not in there.
+    template<typename T, typename... Ts>
+    constexpr std::size_t index_of = [] {
+      constexpr bool matches[] = { std::is_same_v<T, Ts>..., false };
+
+      std::size_t i = 0;
+      while(i < sizeof...(Ts) && !matches[i]) {
+        ++i;
+      }
+
+      return i;
+    }();
+
+    template<std::size_t I, typename... Ts>
+    using type_at = std::tuple_element_t<I, std::tuple<Ts...>>;
+
+    // Up to this many types, dispatch_index uses a comparison chain instead of a jump table.
+    constexpr std::size_t dispatch_chain_limit = 8;
+
+    template<typename R, typename F, typename... Args>
+    constexpr R invoke_r(F &&f, Args&&... args) {
+      if constexpr(std::is_void_v<R>) {
+        std::invoke(std::forward<F>(f), std::forward<Args>(args)...);
+      } else {
+        return std::invoke(std::forward<F>(f), std::forward<Args>(args)...);
+      }
+    }
+
+    template<std::size_t I, std::size_t N, typename R, typename F>
+    constexpr R dispatch_chain(std::size_t index, F &f) {
+      // The last type is the fallthrough case, so there is no path left without a return value.
+      if constexpr(I + 1 == N) {
+        return f(std::integral_constant<std::size_t, I>{});
+      } else {
+        if(index == I) {
+          return f(std::integral_constant<std::size_t, I>{});
+        }
+
+        return dispatch_chain<I + 1, N, R>(index, f);
+      }
+    }
+
+    template<std::size_t I, typename R, typename F>
+    R dispatch_entry(F &f) {
+      return f(std::integral_constant<std::size_t, I>{});
+    }
+
+    template<typename R, typename F, std::size_t... I>
+    R dispatch_table(std::size_t index, F &f, std::index_sequence<I...>) {
+      static constexpr R (*table[])(F &) = { &dispatch_entry<I, R, F>... };
+      return table[index](f);
+    }
+
+    // Calls f(std::integral_constant<std::size_t, I>{}) with I == index and returns its result.
+    // index must be less than N. The table cannot be used in constant expressions, so those always take
+    // the comparison chain.
+    template<std::size_t N, typename R, typename F>
+    constexpr R dispatch_index(std::size_t index, F &&f) {
+      static_assert(N > 0, "cannot dispatch over an empty type list");
+      assert(index < N);
+
+      if constexpr(N <= dispatch_chain_limit) {
+        return dispatch_chain<0, N, R>(index, f);
+      } else {
+        if(std::is_constant_evaluated()) {
+          return dispatch_chain<0, N, R>(index, f);
+        }
+
+        return dispatch_table<R>(index, f, std::make_index_sequence<N>{});
+      }
+    }
+
+    // Result type of visiting with F, which has to be the same for all argument types.
+    template<typename F, typename First, typename... Rest>
+    struct visit_result {
+      using type = std::invoke_result_t<F, First>;
+
+      static_assert(std::conjunction_v<std::is_same<type, std::invoke_result_t<F, Rest>>...>,
+                    "visit() requires the same result type for all possible types, use visit<R>() otherwise");
+    };
+
+    template<typename F, typename... Ts>
+    using visit_result_t = typename visit_result<F, Ts...>::type;
+
+    // FNV-1a over the names, sizes and alignments of Ts, to check that data written by one process is read
+    // with the same type list by another.
+    template<typename... Ts>
+    std::uint64_t type_list_fingerprint() noexcept {
+      std::uint64_t hash = 0xcbf29ce484222325;
+
+      auto mix = [&](std::uint64_t x) {
+        hash = (hash ^ x) * 0x100000001b3;
+      };
+
+      auto mix_type = [&]<typename T>(std::type_identity<T>) {
+        for(char const *p = typeid(T).name(); *p != '\0'; ++p) {
+          mix(static_cast<unsigned char>(*p));
+        }
+
+        mix(sizeof(T));
+        mix(alignof(T));
+      };
+
+      (mix_type(std::type_identity<Ts>{}), ...);
+
+      return hash;
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,124 @@
+#include <boost/test/unit_test.hpp>
+#include <inplace/algorithm.hh>
+#include <inplace/factory.hh>
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace {
+  struct algo_base {
+    virtual ~algo_base() { }
+    virtual int val() const = 0;
+  };
+
+  struct algo_one final : algo_base {
+    int val() const override { return 1; }
+  };
+
+  struct algo_x final : algo_base {
+    algo_x(int x) : x_(x) { }
+    int val() const override { return x_; }
+
+    int x_;
+  };
+
+  struct algo_unused final : algo_base {
+    int val() const override { return -1; }
+  };
+
+  typedef inplace::factory<algo_base,
+                           algo_one,
+                           algo_x,
+                           algo_unused> factory_t;
+
+  std::vector<factory_t> make_batch() {
+    std::vector<factory_t> v(6);
+
+    v[0].construct<algo_x>(10);
+    v[1].construct<algo_one>();
+    v[3].construct<algo_x>(20);
+    v[4].construct<algo_one>();
+    v[5].construct<algo_x>(30);
+
+    return v;
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(algorithm_suite)
+
+BOOST_AUTO_TEST_CASE(AlgorithmIndex) {
+  factory_t fct;
+
+  BOOST_CHECK_EQUAL(factory_t::type_count, 3u);
+  BOOST_CHECK_EQUAL(fct.index(), factory_t::npos);
+  BOOST_CHECK(fct.get_if<algo_one>() == nullptr);
+
+  fct.construct<algo_x>(10);
+
+  BOOST_CHECK_EQUAL(fct.index(), factory_t::index_of<algo_x>);
+  BOOST_CHECK_EQUAL(fct.index(), 1u);
+  BOOST_CHECK(fct.get_if<algo_one>() == nullptr);
+  BOOST_REQUIRE(fct.get_if<algo_x>() != nullptr);
+  BOOST_CHECK_EQUAL(fct.get_if<algo_x>()->x_, 10);
+  BOOST_CHECK((std::is_same_v<factory_t::type_at<1>, algo_x>));
+}
+
+BOOST_AUTO_TEST_CASE(AlgorithmPartition) {
+  std::vector<factory_t> v = make_batch();
+
+  auto partition = inplace::partition_by_type(v);
+
+  BOOST_CHECK_EQUAL(partition.elements().size(), v.size());
+
+  BOOST_REQUIRE_EQUAL(partition.bucket<algo_one>().size(), 2u);
+  BOOST_CHECK_EQUAL(partition.bucket<algo_one>()[0], &v[1]);
+  BOOST_CHECK_EQUAL(partition.bucket<algo_one>()[1], &v[4]);
+
+  BOOST_REQUIRE_EQUAL(partition.bucket(1).size(), 3u);
+  BOOST_CHECK_EQUAL(partition.bucket(1)[0], &v[0]);
+  BOOST_CHECK_EQUAL(partition.bucket(1)[1], &v[3]);
+  BOOST_CHECK_EQUAL(partition.bucket(1)[2], &v[5]);
+
+  BOOST_CHECK(partition.bucket<algo_unused>().empty());
+
+  BOOST_REQUIRE_EQUAL(partition.empties().size(), 1u);
+  BOOST_CHECK_EQUAL(partition.empties()[0], &v[2]);
+
+  v[2].construct<algo_unused>();
+  partition.assign(v);
+
+  BOOST_CHECK_EQUAL(partition.bucket<algo_unused>().size(), 1u);
+  BOOST_CHECK(partition.empties().empty());
+}
+
+BOOST_AUTO_TEST_CASE(AlgorithmForEachGrouped) {
+  std::vector<factory_t> v = make_batch();
+  std::vector<std::string> calls;
+
+  struct recorder {
+    std::vector<std::string> &calls;
+
+    void operator()(algo_one    &obj) const { calls.push_back("one" + std::to_string(obj.val())); }
+    void operator()(algo_x      &obj) const { calls.push_back("x"   + std::to_string(obj.val())); }
+    void operator()(algo_unused &    ) const { calls.push_back("unused"); }
+  };
+
+  inplace::for_each_grouped(v, recorder{ calls });
+
+  BOOST_CHECK((calls == std::vector<std::string>{ "one1", "one1", "x10", "x20", "x30" }));
+}
+
+BOOST_AUTO_TEST_CASE(AlgorithmConstRange) {
+  std::vector<factory_t> const v = make_batch();
+  int sum = 0;
+
+  inplace::for_each_grouped(v, [&](auto &obj) {
+      BOOST_CHECK(std::is_const_v<std::remove_reference_t<decltype(obj)>>);
+      sum += obj.val();
+    });
+
+  BOOST_CHECK_EQUAL(sum, 1 + 1 + 10 + 20 + 30);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,287 @@
+#include <boost/test/unit_test.hpp>
+#include <inplace/archive.hh>
+#include <inplace/factory_vector.hh>
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+  struct archive_base {
+    virtual ~archive_base() { }
+    virtual std::string describe() const = 0;
+  };
+
+  // Polymorphic, so it goes through the hooks. Not movable either, it is constructed right in the factory.
+  struct archive_named : archive_base {
+    archive_named(std::string name, int weight) : name(std::move(name)), weight(weight) { }
+    archive_named(archive_named const &) = delete;
+
+    template<typename Reader>
+    archive_named(inplace::from_archive_t, Reader &in)
+      : weight(inplace::read_value<int>(in))
+    {
+      name.resize(inplace::read_value<std::uint32_t>(in));
+      in.read(name.data(), name.size());
+    }
+
+    std::string describe() const override { return name + "/" + std::to_string(weight); }
+
+    std::string name;
+    int         weight;
+  };
+
+  template<typename Writer>
+  void serialize(Writer &out, archive_named const &obj) {
+    inplace::write_value(out, obj.weight);
+    inplace::write_value(out, static_cast<std::uint32_t>(obj.name.size()));
+    out.write(obj.name.data(), obj.name.size());
+  }
+
+  struct archive_counter : archive_base {
+    archive_counter(long n) : n(n) { }
+
+    template<typename Reader>
+    archive_counter(inplace::from_archive_t, Reader &in) : n(inplace::read_value<long>(in)) { }
+
+    std::string describe() const override { return std::to_string(n); }
+
+    long n;
+  };
+
+  template<typename Writer>
+  void serialize(Writer &out, archive_counter const &obj) {
+    inplace::write_value(out, obj.n);
+  }
+
+  typedef inplace::factory<archive_base, archive_named, archive_counter> factory_t;
+
+  // Trivially copyable types are written as their bytes.
+  struct raw_base { int kind; };
+  struct raw_small : raw_base { int x; };
+  struct raw_large : raw_base { int values[200]; };
+
+  typedef inplace::factory<raw_base, raw_small, raw_large> raw_factory_t;
+
+  struct memfd {
+    memfd() : fd(::memfd_create("group_archive", MFD_CLOEXEC)) {
+      if(fd == -1) {
+        throw std::system_error(errno, std::generic_category(), "memfd_create");
+      }
+    }
+
+    ~memfd() { ::close(fd); }
+
+    void rewind() { ::lseek(fd, 0, SEEK_SET); }
+
+    int fd;
+  };
+}
+
+BOOST_AUTO_TEST_SUITE(archive_suite)
+
+BOOST_AUTO_TEST_CASE(ArchiveHooks) {
+  std::deque<factory_t> in(3);
+
+  in[0].construct<archive_named  >("first", 1);
+  in[2].construct<archive_counter>(42);
+
+  std::vector<std::byte> bytes;
+  inplace::buffer_writer writer(bytes);
+  inplace::save_all(writer, in);
+
+  std::deque<factory_t> out;
+  inplace::buffer_reader reader(bytes);
+
+  BOOST_CHECK_EQUAL(inplace::load_all(reader, out), 3u);
+  BOOST_REQUIRE_EQUAL(out.size(), 3u);
+
+  BOOST_CHECK_EQUAL(out[0]->describe(), "first/1");
+  BOOST_CHECK      (!out[1]);
+  BOOST_CHECK_EQUAL(out[2]->describe(), "42");
+  BOOST_CHECK_EQUAL(out[2].index(), factory_t::index_of<archive_counter>);
+}
+
+BOOST_AUTO_TEST_CASE(ArchiveRaw) {
+  raw_factory_t small;
+  raw_factory_t large;
+
+  small.construct<raw_small>(raw_small { { 1 }, 17 });
+  large.construct<raw_large>();
+  large.get_if<raw_large>()->values[199] = 99;
+
+  std::vector<std::byte> bytes;
+  inplace::buffer_writer writer(bytes);
+  inplace::save(writer, small);
+  inplace::save(writer, large);
+
+  BOOST_CHECK_EQUAL(bytes.size(), 2 * sizeof(std::uint32_t) + sizeof(raw_small) + sizeof(raw_large));
+
+  raw_factory_t a;
+  raw_factory_t b;
+  inplace::buffer_reader reader(bytes);
+
+  inplace::load(reader, a);
+  inplace::load(reader, b);
+
+  BOOST_CHECK      (reader.at_end());
+  BOOST_CHECK_EQUAL(a.get_if<raw_small>()->x, 17);
+  BOOST_CHECK_EQUAL(a->kind, 1);
+  BOOST_CHECK_EQUAL(b.get_if<raw_large>()->values[199], 99);
+}
+
+BOOST_AUTO_TEST_CASE(ArchiveFileDescriptor) {
+  std::vector<raw_factory_t> raw(5000);
+  std::deque<factory_t>      hooked(5000);
+
+  for(int i = 0; i < 5000; ++i) {
+    if(i % 3 == 0) {
+      raw[i].construct<raw_large>();
+      raw[i].get_if<raw_large>()->values[0] = i;
+    } else {
+      raw[i].construct<raw_small>(raw_small { { 0 }, i });
+    }
+
+    hooked[i].construct<archive_named>(std::string(i % 50, 'x'), i);
+  }
+
+  memfd file;
+
+  {
+    // more large objects than fit into one writev() call
+    inplace::fd_writer writer(file.fd);
+    inplace::save_all(writer, raw);
+    inplace::save_all(writer, hooked);
+  }
+
+  file.rewind();
+
+  std::vector<raw_factory_t> raw_in;
+  std::deque<factory_t>      hooked_in;
+
+  inplace::fd_reader reader(file.fd, 1000);
+  inplace::load_header<raw_factory_t>(reader);
+
+  for(int i = 0; i < 5000; ++i) {
+    inplace::load(reader, raw_in.emplace_back());
+  }
+
+  BOOST_CHECK_EQUAL(inplace::load_all(reader, hooked_in), 5000u);
+
+  bool equal = true;
+
+  for(int i = 0; i < 5000; ++i) {
+    equal = equal
+      && (i % 3 == 0 ? raw_in[i].get_if<raw_large>()->values[0] : raw_in[i].get_if<raw_small>()->x) == i
+      && hooked_in[i]->describe() == hooked[i]->describe();
+  }
+
+  BOOST_CHECK(equal);
+}
+
+BOOST_AUTO_TEST_CASE(ArchiveFileDescriptorDestructorFlushes) {
+  raw_factory_t out;
+  out.construct<raw_small>(raw_small { { 0 }, 7 });
+
+  memfd file;
+
+  {
+    inplace::fd_writer writer(file.fd);
+    inplace::save(writer, out);
+  }
+
+  file.rewind();
+
+  raw_factory_t      in;
+  inplace::fd_reader reader(file.fd);
+  inplace::load(reader, in);
+
+  BOOST_REQUIRE(in.get_if<raw_small>() != nullptr);
+  BOOST_CHECK_EQUAL(in.get_if<raw_small>()->x, 7);
+}
+
+BOOST_AUTO_TEST_CASE(ArchiveFactoryVector) {
+  inplace::factory_vector<raw_factory_t> in;
+
+  for(int i = 0; i < 10; ++i) {
+    in.emplace_back<raw_small>(raw_small { { i }, 2 * i });
+  }
+
+  in.push_back(raw_factory_t());
+
+  std::vector<std::byte> bytes;
+  inplace::buffer_writer writer(bytes);
+  inplace::save_all(writer, in);
+
+  inplace::factory_vector<raw_factory_t> out;
+  inplace::buffer_reader reader(bytes);
+
+  BOOST_CHECK_EQUAL(inplace::load_all(reader, out), 11u);
+  BOOST_REQUIRE_EQUAL(out.size(), 11u);
+
+  BOOST_CHECK_EQUAL(out[3]->kind, 3);
+  BOOST_CHECK_EQUAL(out[9].get_if<raw_small>()->x, 18);
+  BOOST_CHECK      (!out[10]);
+}
+
+BOOST_AUTO_TEST_CASE(ArchiveErrors) {
+  factory_t fct;
+  fct.construct<archive_named>("name", 2);
+
+  std::deque<factory_t> one(1);
+  one[0].construct<archive_named>("name", 2);
+
+  std::vector<std::byte> bytes;
+  inplace::buffer_writer writer(bytes);
+  inplace::save_all(writer, one);
+
+  // truncated
+  {
+    std::deque<factory_t> out;
+    inplace::buffer_reader reader(std::span<std::byte const>(bytes).first(bytes.size() - 1));
+
+    BOOST_CHECK_THROW(inplace::load_all(reader, out), inplace::archive_error);
+    BOOST_CHECK      (out.empty());
+  }
+
+  // wrong type list
+  {
+    std::vector<raw_factory_t> out;
+    inplace::buffer_reader reader(bytes);
+
+    BOOST_CHECK_THROW(inplace::load_all(reader, out), inplace::archive_error);
+    BOOST_CHECK      (out.empty());
+  }
+
+  // no header
+  {
+    std::vector<std::byte> bad(bytes);
+    bad[0] = std::byte { 0 };
+
+    std::deque<factory_t> out;
+    inplace::buffer_reader reader(bad);
+
+    BOOST_CHECK_THROW(inplace::load_all(reader, out), inplace::archive_error);
+  }
+
+  // unknown type
+  {
+    std::vector<std::byte> bad(bytes.begin() + 2 * sizeof(std::uint64_t), bytes.end());
+    bad[0] = std::byte { 7 };
+
+    factory_t target;
+    target.construct<archive_counter>(1);
+
+    inplace::buffer_reader reader(bad);
+
+    BOOST_CHECK_THROW(inplace::load(reader, target), inplace::archive_error);
+    BOOST_CHECK_EQUAL(target->describe(), "1");
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
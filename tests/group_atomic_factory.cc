@@ -0,0 +1,164 @@
+#include <boost/test/unit_test.hpp>
+#include <inplace/atomic_factory.hh>
+#include <inplace/factory.hh>
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+  std::atomic<int> atomic_destroyed { 0 };
+
+  struct atomic_base {
+    atomic_base(int x) : x_(x), check_(~x) { }
+    virtual ~atomic_base() { check_ = x_; ++atomic_destroyed; }
+
+    virtual int val() const = 0;
+
+    // false once the object was destroyed
+    bool alive() const { return check_ == ~x_; }
+
+  protected:
+    int x_;
+    int check_;
+  };
+
+  struct atomic_plus  : atomic_base { using atomic_base::atomic_base; virtual int val() const { return  x_; } };
+  struct atomic_minus : atomic_base { using atomic_base::atomic_base; virtual int val() const { return -x_; } };
+
+  struct atomic_throwing : atomic_base {
+    atomic_throwing(int x) : atomic_base(x) { throw std::runtime_error("atomic_throwing"); }
+    virtual int val() const { return 0; }
+  };
+
+  typedef inplace::factory<atomic_base, atomic_plus, atomic_minus, atomic_throwing> factory_t;
+}
+
+BOOST_AUTO_TEST_SUITE(atomic_factory_suite)
+
+BOOST_AUTO_TEST_CASE(AtomicFactoryPublish) {
+  inplace::atomic_factory<factory_t> af;
+
+  BOOST_CHECK(!af.read());
+
+  af.construct<atomic_plus>(1);
+
+  {
+    auto h = af.read();
+
+    BOOST_REQUIRE(h);
+    BOOST_CHECK_EQUAL(h->val(), 1);
+  }
+
+  af.construct<atomic_minus>(2);
+
+  BOOST_CHECK_EQUAL(af.read()->val(), -2);
+
+  af.clear();
+
+  BOOST_CHECK(!af.read());
+}
+
+BOOST_AUTO_TEST_CASE(AtomicFactoryGracePeriod) {
+  inplace::atomic_factory<factory_t, 2> af;
+
+  af.construct<atomic_plus>(1);
+
+  auto h = af.read();
+  atomic_destroyed = 0;
+
+  af.construct<atomic_plus>(2);
+  af.reclaim();
+
+  // still read through h
+  BOOST_CHECK_EQUAL(atomic_destroyed, 0);
+  BOOST_CHECK      (h->alive());
+  BOOST_CHECK_EQUAL(h->val(), 1);
+  BOOST_CHECK_EQUAL(af.read()->val(), 2);
+
+  { auto gone = std::move(h); }
+  af.reclaim();
+
+  BOOST_CHECK_EQUAL(atomic_destroyed, 1);
+
+  af.construct<atomic_plus>(3);
+
+  BOOST_CHECK_EQUAL(af.read()->val(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(AtomicFactoryReleaseOnOtherThread) {
+  inplace::atomic_factory<factory_t, 2> af;
+
+  af.construct<atomic_plus>(1);
+
+  auto h = af.read();
+  atomic_destroyed = 0;
+
+  af.construct<atomic_plus>(2);
+
+  // the handle is released on a thread that counts its reads in another counter
+  std::thread([gone = std::move(h)] { }).join();
+  af.reclaim();
+
+  BOOST_CHECK_EQUAL(atomic_destroyed, 1);
+}
+
+BOOST_AUTO_TEST_CASE(AtomicFactoryMovedFromHandle) {
+  inplace::atomic_factory<factory_t> af;
+
+  af.construct<atomic_plus>(1);
+
+  auto h     = af.read();
+  auto moved = std::move(h);
+
+  BOOST_CHECK(!h);
+  BOOST_CHECK( moved);
+}
+
+BOOST_AUTO_TEST_CASE(AtomicFactoryThrowingConstruct) {
+  inplace::atomic_factory<factory_t> af;
+
+  af.construct<atomic_plus>(1);
+
+  BOOST_CHECK_THROW(af.construct<atomic_throwing>(2), std::runtime_error);
+  BOOST_REQUIRE    (af.read());
+  BOOST_CHECK_EQUAL(af.read()->val(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(AtomicFactoryConcurrentReaders) {
+  inplace::atomic_factory<factory_t> af;
+  af.construct<atomic_plus>(0);
+
+  std::atomic<bool> done   { false };
+  std::atomic<int>  broken { 0 };
+  std::vector<std::thread> readers;
+
+  // more readers than reader counters, so some of them share one
+  for(int i = 0; i < 12; ++i) {
+    readers.emplace_back([&] {
+        while(!done.load(std::memory_order_relaxed)) {
+          auto h = af.read();
+
+          if(!h || !h->alive() || h->val() < 0) {
+            ++broken;
+          }
+        }
+      });
+  }
+
+  for(int i = 1; i <= 2000; ++i) {
+    af.construct<atomic_plus>(i);
+  }
+
+  done = true;
+
+  for(std::thread &t : readers) {
+    t.join();
+  }
+
+  BOOST_CHECK_EQUAL(broken, 0);
+  BOOST_CHECK_EQUAL(af.read()->val(), 2000);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
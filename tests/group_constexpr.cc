@@ -0,0 +1,179 @@
+#include <boost/test/unit_test.hpp>
+#include <inplace/factory.hh>
+
+#include <utility>
+
+namespace {
+  // Destructors are spelled out: GCC 12 does not evaluate implicit virtual destructors in constant expressions.
+  struct ce_base {
+    constexpr virtual ~ce_base() { }
+    constexpr virtual int val() const = 0;
+  };
+
+  struct ce_x : ce_base {
+    constexpr ce_x(int x) : x_(x) { }
+    constexpr ~ce_x() override { }
+    constexpr int val() const override { return x_; }
+
+    constexpr ce_x &operator=(int x) { x_ = x + 100; return *this; }
+
+    int x_;
+  };
+
+  struct ce_large : ce_base {
+    constexpr ce_large(int first, int last) {
+      for(int i = 0; i < 8; ++i) {
+        values[i] = first + (last - first) * i / 7;
+      }
+    }
+
+    constexpr ~ce_large() override { }
+    constexpr int val() const override { return values[0] + values[7]; }
+
+    int values[8];
+  };
+
+  // Not copyable at all, only movable.
+  struct ce_move_only : ce_base {
+    constexpr ce_move_only(int x) : x_(x) { }
+    constexpr ce_move_only(ce_move_only &&other) : x_(std::exchange(other.x_, -1)) { }
+    constexpr ~ce_move_only() override { }
+    constexpr int val() const override { return x_; }
+
+    int x_;
+  };
+
+  typedef inplace::factory<ce_base, ce_x, ce_large> factory_t;
+  typedef inplace::factory<ce_base, ce_x, ce_move_only> move_factory_t;
+
+  template<typename T, typename... Args>
+  constexpr factory_t make(Args... args) {
+    factory_t result;
+    result.construct<T>(args...);
+    return result;
+  }
+
+  // Built at compile time, no static initialization.
+  constinit factory_t global = make<ce_x>(7);
+
+  constexpr factory_t table[] = {
+    make<ce_x    >(1),
+    make<ce_large>(2, 9),
+    factory_t()
+  };
+
+  // Compile-time use of a trivially copyable factory.
+  struct ce_point_base { int x; };
+  struct ce_point_2d : ce_point_base { int y; };
+  struct ce_point_3d : ce_point_base { int y, z; };
+
+  typedef inplace::factory<ce_point_base, ce_point_2d, ce_point_3d> point_factory_t;
+
+  // Trivially copyable, but not assignable.
+  struct ce_point_fixed : ce_point_base { int const y; };
+
+  typedef inplace::factory<ce_point_base, ce_point_2d, ce_point_fixed> fixed_factory_t;
+}
+
+static_assert([] {
+    factory_t fct;
+
+    if(fct.is_initialized() || fct.get_ptr() != nullptr || fct.index() != factory_t::npos) {
+      return false;
+    }
+
+    fct.construct<ce_large>(1, 8);
+    return fct && fct.get().val() == 9 && fct.index() == 1 && fct.get_if<ce_x>() == nullptr;
+  }());
+
+static_assert([] {
+    factory_t a = make<ce_x>(3);
+    factory_t b = a;
+    factory_t c = std::move(b);
+
+    return a->val() == 3 && !b && c->val() == 3;
+  }());
+
+static_assert([] {
+    factory_t a = make<ce_x>(1);
+    factory_t b = make<ce_large>(2, 3);
+
+    swap(a, b);
+    a.clear();
+
+    return !a && b->val() == 1;
+  }());
+
+static_assert([] {
+    factory_t fct;
+
+    fct.emplace_or_assign<ce_x>(1);
+    fct.emplace_or_assign<ce_x>(2);
+
+    return fct.get_if<ce_x>() != nullptr && fct.get_if<ce_x>()->x_ == 102;
+  }());
+
+static_assert([] {
+    factory_t fct = make<ce_large>(0, 14);
+
+    return fct.visit([](auto const &obj) { return sizeof(obj); }) == sizeof(ce_large);
+  }());
+
+static_assert([] {
+    move_factory_t a;
+    a.construct<ce_move_only>(5);
+
+    move_factory_t b = std::move(a);
+    return !a && b->val() == 5;
+  }());
+
+static_assert([] {
+    point_factory_t a;
+    a.construct<ce_point_3d>(ce_point_3d { { 1 }, 2, 3 });
+
+    point_factory_t b = a;
+    return b.get().x == 1 && b.get_if<ce_point_3d>()->z == 3;
+  }());
+
+static_assert([] {
+    fixed_factory_t a;
+    a.construct<ce_point_fixed>(ce_point_fixed { { 1 }, 2 });
+
+    fixed_factory_t b;
+    b.construct<ce_point_2d>(ce_point_2d { { 3 }, 4 });
+    b = a;
+    return b.get_if<ce_point_fixed>()->y == 2;
+  }());
+
+static_assert(table[1]->val() == 11);
+
+BOOST_AUTO_TEST_SUITE(constexpr_suite)
+
+BOOST_AUTO_TEST_CASE(ConstexprConstinit) {
+  BOOST_CHECK_EQUAL(global->val(), 7);
+
+  global.construct<ce_large>(1, 2);
+  BOOST_CHECK_EQUAL(global->val(), 3);
+
+  global = make<ce_x>(7);
+  BOOST_CHECK_EQUAL(global->val(), 7);
+}
+
+BOOST_AUTO_TEST_CASE(ConstexprTable) {
+  int sum = 0;
+
+  for(factory_t const &fct : table) {
+    if(fct) {
+      sum += fct->val();
+    }
+  }
+
+  BOOST_CHECK_EQUAL(sum, 12);
+
+  // and at runtime, objects built at compile time are copied like any other
+  factory_t copy = table[1];
+  BOOST_CHECK_EQUAL(copy->val(), 11);
+  BOOST_CHECK_EQUAL(copy.index(), 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,213 @@
+#include <boost/test/unit_test.hpp>
+#include <inplace/factory_pool.hh>
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+  struct pool_base {
+    virtual ~pool_base() { }
+    virtual int val() const = 0;
+  };
+
+  class pool_child_x : public pool_base {
+  public:
+    pool_child_x(int x) : x_(x) { }
+    virtual int val() const { return x_; }
+
+  private:
+    int x_;
+  };
+
+  struct pool_child_1 : pool_base { virtual int val() const { return 1; } };
+
+  struct pool_throwing : pool_base {
+    pool_throwing() { throw std::runtime_error("pool_throwing"); }
+    virtual int val() const { return 0; }
+  };
+
+  typedef inplace::factory_pool<pool_base, pool_child_x, pool_child_1, pool_throwing> pool_t;
+}
+
+BOOST_AUTO_TEST_SUITE(factory_pool_suite)
+
+BOOST_AUTO_TEST_CASE(FactoryPoolEmplace) {
+  pool_t pool(4);
+
+  pool_t::handle h1 = pool.emplace<pool_child_x>(10);
+  pool_t::handle h2 = pool.emplace<pool_child_1>();
+
+  BOOST_REQUIRE(h1);
+  BOOST_REQUIRE(h2);
+  BOOST_REQUIRE(pool.get(h1) != nullptr);
+  BOOST_REQUIRE(pool.get(h2) != nullptr);
+  BOOST_CHECK_EQUAL(pool.get(h1)->val(), 10);
+  BOOST_CHECK_EQUAL(pool.get(h2)->val(), 1);
+  BOOST_CHECK      (pool.get_factory(h2)->get_if<pool_child_1>() != nullptr);
+
+  BOOST_CHECK(pool.get(pool_t::handle()) == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(FactoryPoolStaleHandle) {
+  pool_t pool(1);
+
+  pool_t::handle h1 = pool.emplace<pool_child_x>(1);
+  pool_base     *p1 = pool.get(h1);
+
+  BOOST_CHECK( pool.erase(h1));
+  BOOST_CHECK(!pool.erase(h1));
+  BOOST_CHECK( pool.get(h1) == nullptr);
+
+  // same slot, new generation
+  pool_t::handle h2 = pool.emplace<pool_child_x>(2);
+
+  BOOST_REQUIRE(h2);
+  BOOST_CHECK  (pool.get(h2) == p1);
+  BOOST_CHECK  (pool.get(h1) == nullptr);
+  BOOST_CHECK  (h1 != h2);
+  BOOST_CHECK_EQUAL(pool.get(h2)->val(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(FactoryPoolExhausted) {
+  pool_t pool(2);
+
+  BOOST_CHECK( pool.emplace<pool_child_1>());
+  BOOST_CHECK( pool.emplace<pool_child_1>());
+  BOOST_CHECK(!pool.emplace<pool_child_1>());
+}
+
+BOOST_AUTO_TEST_CASE(FactoryPoolThrowingCtor) {
+  pool_t pool(1);
+
+  BOOST_CHECK_THROW(pool.emplace<pool_throwing>(), std::runtime_error);
+  BOOST_CHECK(pool.emplace<pool_child_1>());
+}
+
+BOOST_AUTO_TEST_CASE(FactoryPoolCache) {
+  pool_t pool(100);
+
+  {
+    pool_t::cache cache(pool);
+    std::vector<pool_t::handle> handles;
+
+    for(int i = 0; i < 100; ++i) {
+      handles.push_back(cache.emplace<pool_child_x>(i));
+      BOOST_REQUIRE(handles.back());
+    }
+
+    BOOST_CHECK(!cache.emplace<pool_child_1>());
+
+    for(int i = 0; i < 100; ++i) {
+      BOOST_CHECK_EQUAL(pool.get(handles[i])->val(), i);
+      BOOST_CHECK(cache.erase(handles[i]));
+    }
+
+    BOOST_CHECK(!cache.erase(handles[0]));
+  }
+
+  // the cache returned everything
+  for(int i = 0; i < 100; ++i) {
+    BOOST_REQUIRE(pool.emplace<pool_child_1>());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(FactoryPoolConcurrent) {
+  constexpr int threads = 4;
+  constexpr int per_thread = 64;
+
+  pool_t pool(threads * per_thread);
+  std::vector<std::thread> workers;
+  std::atomic<int> broken { 0 };
+
+  for(int t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+        pool_t::cache cache(pool);
+        std::vector<pool_t::handle> handles;
+
+        for(int round = 0; round < 200; ++round) {
+          for(int i = 0; i < per_thread / 2; ++i) {
+            handles.push_back(cache.emplace<pool_child_x>(t * 1000 + i));
+          }
+
+          for(std::size_t i = 0; i < handles.size(); ++i) {
+            pool_base *p = pool.get(handles[i]);
+
+            if(p == nullptr || p->val() != t * 1000 + static_cast<int>(i) || !cache.erase(handles[i])) {
+              ++broken;
+            }
+          }
+
+          handles.clear();
+        }
+      });
+  }
+
+  for(std::thread &w : workers) {
+    w.join();
+  }
+
+  BOOST_CHECK_EQUAL(broken, 0);
+
+  for(int i = 0; i < threads * per_thread; ++i) {
+    BOOST_REQUIRE(pool.emplace<pool_child_1>());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(FactoryPoolConcurrentDoubleErase) {
+  constexpr int threads  = 4;
+  constexpr int rounds   = 2000;
+  constexpr int capacity = 16;
+
+  pool_t pool(capacity);
+  pool_t::handle h;
+
+  std::atomic<int> ready  { -1 };
+  std::atomic<int> done   { 0 };
+  std::atomic<int> erased { 0 };
+  std::vector<std::thread> erasers;
+
+  // all threads erase the same handle in every round
+  for(int t = 0; t < threads; ++t) {
+    erasers.emplace_back([&] {
+        for(int round = 0; round < rounds; ++round) {
+          while(ready.load(std::memory_order_acquire) < round) {
+            std::this_thread::yield();
+          }
+
+          if(pool.erase(h)) {
+            ++erased;
+          }
+
+          ++done;
+        }
+      });
+  }
+
+  for(int round = 0; round < rounds; ++round) {
+    h = pool.emplace<pool_child_x>(round);
+    BOOST_REQUIRE(h);
+
+    ready.store(round, std::memory_order_release);
+
+    while(done.load(std::memory_order_acquire) < threads * (round + 1)) {
+      std::this_thread::yield();
+    }
+  }
+
+  for(std::thread &e : erasers) {
+    e.join();
+  }
+
+  BOOST_CHECK_EQUAL(erased, rounds);
+
+  // every slot is on the free list exactly once
+  for(int i = 0; i < capacity; ++i) {
+    BOOST_REQUIRE(pool.emplace<pool_child_1>());
+  }
+
+  BOOST_CHECK(!pool.emplace<pool_child_1>());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,251 @@
+#include <boost/test/unit_test.hpp>
+#include <inplace/factory.hh>
+#include <inplace/factory_vector.hh>
+#include <inplace/storage_policy.hh>
+
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace {
+  int vec_copies = 0;
+  int vec_moves  = 0;
+
+  // copies and moves of vec_fragile left until one throws, -1 for never
+  int vec_fragile_countdown = -1;
+
+  struct vec_base {
+    vec_base(int x) : x_(std::make_unique<int>(x)) { }
+    vec_base(vec_base const &other) : x_(std::make_unique<int>(*other.x_)) { ++vec_copies; }
+    vec_base(vec_base      &&other) : x_(std::move(other.x_))              { ++vec_moves;  }
+
+    virtual ~vec_base() { }
+
+    int val() const { return x_ ? *x_ : -1; }
+
+  private:
+    std::unique_ptr<int> x_;
+  };
+
+  // only holds a unique_ptr, so it can be relocated bytewise
+  struct vec_relocatable : vec_base { using vec_base::vec_base; };
+
+  // must be moved the regular way
+  struct vec_pinned : vec_base { using vec_base::vec_base; };
+
+  struct vec_throwing : vec_base {
+    vec_throwing(int x) : vec_base(x) { throw std::runtime_error("vec_throwing"); }
+  };
+
+  // neither relocatable nor safe to copy or move
+  struct vec_fragile : vec_base {
+    vec_fragile(int x) : vec_base(x) { }
+    vec_fragile(vec_fragile const &other) : vec_base(other)            { tick(); }
+    vec_fragile(vec_fragile      &&other) : vec_base(std::move(other)) { tick(); }
+
+    static void tick() {
+      if(vec_fragile_countdown >= 0 && vec_fragile_countdown-- == 0) {
+        throw std::runtime_error("vec_fragile");
+      }
+    }
+  };
+
+  struct vec_trivial_base { int x; };
+  struct vec_trivial : vec_trivial_base { };
+  struct vec_large : vec_base { using vec_base::vec_base; char padding[256]; };
+
+  void reset_counters() {
+    vec_copies = 0;
+    vec_moves  = 0;
+  }
+}
+
+template<> struct inplace::is_trivially_relocatable<vec_relocatable> : std::true_type { };
+template<> struct inplace::is_trivially_relocatable<vec_throwing   > : std::true_type { };
+
+namespace {
+  typedef inplace::factory<vec_base, vec_relocatable, vec_throwing> relocatable_t;
+  typedef inplace::factory<vec_base, vec_relocatable, vec_pinned  > pinned_t;
+  typedef inplace::factory<vec_base, vec_relocatable, vec_fragile > fragile_t;
+
+  template<typename factory_type>
+  void check_values(inplace::factory_vector<factory_type> const &v, std::initializer_list<int> expected) {
+    BOOST_REQUIRE_EQUAL(v.size(), expected.size());
+
+    int const *e = expected.begin();
+    for(factory_type const &fct : v) {
+      BOOST_REQUIRE(fct);
+      BOOST_CHECK_EQUAL(fct->val(), *e++);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(factory_vector_suite)
+
+BOOST_AUTO_TEST_CASE(FactoryVectorTrait) {
+  BOOST_CHECK( inplace::is_trivially_relocatable_v<relocatable_t>);
+  BOOST_CHECK(!inplace::is_trivially_relocatable_v<pinned_t>);
+  BOOST_CHECK((inplace::is_trivially_relocatable_v<inplace::factory<vec_trivial_base, vec_trivial>>));
+
+  // spilled objects are not relocated at all
+  BOOST_CHECK((inplace::is_trivially_relocatable_v<inplace::basic_factory<inplace::spill_storage<64>, vec_base, vec_relocatable, vec_large>>));
+  BOOST_CHECK((!inplace::is_trivially_relocatable_v<inplace::factory<vec_base, vec_relocatable, vec_large>>));
+}
+
+BOOST_AUTO_TEST_CASE(FactoryVectorGrowRelocatable) {
+  inplace::factory_vector<relocatable_t> v;
+
+  reset_counters();
+
+  for(int i = 0; i < 100; ++i) {
+    v.emplace_back<vec_relocatable>(i);
+  }
+
+  BOOST_CHECK_EQUAL(vec_copies, 0);
+  BOOST_CHECK_EQUAL(vec_moves , 0);
+  BOOST_REQUIRE_EQUAL(v.size(), 100u);
+  BOOST_CHECK      (v.capacity() >= 100u);
+
+  for(int i = 0; i < 100; ++i) {
+    BOOST_CHECK_EQUAL(v[i]->val(), i);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(FactoryVectorGrowPinned) {
+  inplace::factory_vector<pinned_t> v;
+
+  for(int i = 0; i < 20; ++i) {
+    if(i % 2 == 0) {
+      v.emplace_back<vec_relocatable>(i);
+    } else {
+      v.emplace_back<vec_pinned>(i);
+    }
+  }
+
+  BOOST_REQUIRE_EQUAL(v.size(), 20u);
+
+  for(int i = 0; i < 20; ++i) {
+    BOOST_CHECK_EQUAL(v[i]->val(), i);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(FactoryVectorErase) {
+  inplace::factory_vector<relocatable_t> v;
+
+  for(int i = 0; i < 6; ++i) {
+    v.emplace_back<vec_relocatable>(i);
+  }
+
+  reset_counters();
+
+  auto it = v.erase(v.begin() + 1);
+
+  BOOST_CHECK(it == v.begin() + 1);
+  check_values(v, { 0, 2, 3, 4, 5 });
+
+  it = v.erase(v.begin() + 2, v.begin() + 4);
+
+  BOOST_CHECK(it == v.begin() + 2);
+  check_values(v, { 0, 2, 5 });
+
+  v.erase(v.end() - 1);
+  check_values(v, { 0, 2 });
+
+  BOOST_CHECK_EQUAL(vec_moves , 0);
+  BOOST_CHECK_EQUAL(vec_copies, 0);
+}
+
+BOOST_AUTO_TEST_CASE(FactoryVectorErasePinned) {
+  inplace::factory_vector<pinned_t> v;
+
+  for(int i = 0; i < 6; ++i) {
+    v.emplace_back<vec_pinned>(i);
+  }
+
+  v.erase(v.begin() + 1);
+  v.erase(v.begin() + 2, v.begin() + 4);
+
+  check_values(v, { 0, 2, 5 });
+}
+
+BOOST_AUTO_TEST_CASE(FactoryVectorPushBackSelf) {
+  inplace::factory_vector<relocatable_t> v;
+  v.emplace_back<vec_relocatable>(7);
+
+  // the reallocation must not invalidate the source before it is copied
+  for(int i = 0; i < 10; ++i) {
+    v.push_back(v.front());
+  }
+
+  BOOST_REQUIRE_EQUAL(v.size(), 11u);
+  BOOST_CHECK_EQUAL(v.back()->val(), 7);
+}
+
+BOOST_AUTO_TEST_CASE(FactoryVectorThrowingEmplace) {
+  inplace::factory_vector<relocatable_t> v;
+
+  for(int i = 0; i < 4; ++i) {
+    v.emplace_back<vec_relocatable>(i);
+  }
+
+  BOOST_CHECK_THROW(v.emplace_back<vec_throwing>(4), std::runtime_error);
+  check_values(v, { 0, 1, 2, 3 });
+}
+
+BOOST_AUTO_TEST_CASE(FactoryVectorThrowingReserve) {
+  inplace::factory_vector<fragile_t> v;
+
+  for(int i = 0; i < 5; ++i) {
+    v.emplace_back<vec_fragile>(i);
+  }
+
+  std::size_t capacity = v.capacity();
+
+  // the third move throws; the new buffer must not leak
+  vec_fragile_countdown = 2;
+  BOOST_CHECK_THROW(v.reserve(100), std::runtime_error);
+  vec_fragile_countdown = -1;
+
+  BOOST_CHECK_EQUAL(v.size(), 5u);
+  BOOST_CHECK_EQUAL(v.capacity(), capacity);
+}
+
+BOOST_AUTO_TEST_CASE(FactoryVectorThrowingCopy) {
+  inplace::factory_vector<fragile_t> v;
+
+  for(int i = 0; i < 5; ++i) {
+    v.emplace_back<vec_fragile>(i);
+  }
+
+  // the fourth copy throws; the copies made so far and the buffer must not leak
+  vec_fragile_countdown = 3;
+  BOOST_CHECK_THROW(inplace::factory_vector<fragile_t> copy(v), std::runtime_error);
+  vec_fragile_countdown = -1;
+
+  check_values(v, { 0, 1, 2, 3, 4 });
+}
+
+BOOST_AUTO_TEST_CASE(FactoryVectorCopyMove) {
+  inplace::factory_vector<relocatable_t> v;
+
+  for(int i = 0; i < 3; ++i) {
+    v.emplace_back<vec_relocatable>(i);
+  }
+
+  inplace::factory_vector<relocatable_t> v2(v);
+  inplace::factory_vector<relocatable_t> v3(std::move(v));
+
+  BOOST_CHECK(v.empty());
+  check_values(v2, { 0, 1, 2 });
+  check_values(v3, { 0, 1, 2 });
+
+  v3.pop_back();
+  v = v3;
+
+  check_values(v , { 0, 1 });
+  check_values(v2, { 0, 1, 2 });
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,66 @@
+#include <boost/test/unit_test.hpp>
+#include <inplace/footprint.hh>
+
+#include <cstddef>
+
+namespace {
+  struct fp_base {
+    virtual ~fp_base() { }
+  };
+
+  struct fp_small : fp_base { char c; };
+  struct fp_medium : fp_base { long values[4]; };
+  struct fp_large : fp_base { char payload[200]; };
+
+  typedef inplace::factory<fp_base, fp_small, fp_medium> factory_t;
+  typedef inplace::footprint<factory_t> footprint_t;
+
+  typedef inplace::basic_factory<inplace::spill_storage<64>, fp_base, fp_small, fp_large> spill_factory_t;
+  typedef inplace::footprint<spill_factory_t> spill_footprint_t;
+
+  // all inline types fit, the large one is spilled
+  typedef inplace::basic_factory<inplace::max_size<48>,                             fp_base, fp_small, fp_medium> budget_factory_t;
+  typedef inplace::basic_factory<inplace::max_size<48, inplace::spill_storage<64>>, fp_base, fp_small, fp_large > budget_spill_factory_t;
+
+  static_assert(footprint_t::storage_size == sizeof(fp_medium));
+  static_assert(footprint_t::factory_size == sizeof(factory_t));
+  static_assert(footprint_t::largest_index == factory_t::index_of<fp_medium>);
+
+  static_assert(!inplace::max_size<32>::fits<fp_medium>);
+  static_assert( inplace::max_size<32, inplace::spill_storage<16>>::fits<fp_medium>);
+}
+
+BOOST_AUTO_TEST_SUITE(footprint_suite)
+
+BOOST_AUTO_TEST_CASE(FootprintInline) {
+  BOOST_CHECK_EQUAL(footprint_t::types.size(), 2u);
+
+  BOOST_CHECK_EQUAL(footprint_t::of<fp_small>.size   , sizeof(fp_small));
+  BOOST_CHECK_EQUAL(footprint_t::of<fp_small>.align  , alignof(fp_small));
+  BOOST_CHECK      (!footprint_t::of<fp_small>.spilled);
+  BOOST_CHECK_EQUAL(footprint_t::of<fp_small>.wasted , sizeof(fp_medium) - sizeof(fp_small));
+  BOOST_CHECK_EQUAL(footprint_t::of<fp_medium>.wasted, 0u);
+
+  BOOST_CHECK_EQUAL(footprint_t::ops_size, footprint_t::overhead);
+}
+
+BOOST_AUTO_TEST_CASE(FootprintSpilled) {
+  BOOST_CHECK      (spill_footprint_t::of<fp_large>.spilled);
+  BOOST_CHECK_EQUAL(spill_footprint_t::of<fp_large>.slot, sizeof(void *));
+  BOOST_CHECK_EQUAL(spill_footprint_t::storage_size, sizeof(fp_small));
+  BOOST_CHECK_EQUAL(spill_footprint_t::largest_index, spill_factory_t::index_of<fp_small>);
+}
+
+BOOST_AUTO_TEST_CASE(FootprintBudget) {
+  budget_factory_t fct;
+  fct.construct<fp_medium>();
+  BOOST_CHECK(fct.get_if<fp_medium>() != nullptr);
+
+  budget_spill_factory_t spilled;
+  spilled.construct<fp_large>();
+  BOOST_CHECK(spilled.get_if<fp_large>() != nullptr);
+
+  BOOST_CHECK_EQUAL(sizeof(budget_factory_t), sizeof(factory_t));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
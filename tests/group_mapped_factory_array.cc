@@ -0,0 +1,136 @@
+#include <boost/test/unit_test.hpp>
+#include <inplace/mapped_factory_array.hh>
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+  struct rule_base {
+    int priority;
+  };
+
+  struct rule_match : rule_base {
+    char pattern[24];
+  };
+
+  struct rule_range : rule_base {
+    long low;
+    long high;
+  };
+
+  struct rule_filler { char padding[12]; };
+
+  // base_type is not the first base class
+  struct rule_flag : rule_filler, rule_base {
+    bool value;
+  };
+
+  typedef inplace::mapped_factory_array<rule_base, rule_match, rule_range, rule_flag> array_t;
+  typedef array_t::factory_type factory_t;
+
+  struct temp_file {
+    temp_file() {
+      char name[] = "/tmp/group_mapped_XXXXXX";
+      int fd = ::mkstemp(name);
+      ::close(fd);
+      path = name;
+    }
+
+    ~temp_file() { std::remove(path.c_str()); }
+
+    std::string path;
+  };
+
+  std::vector<factory_t> make_rules(int count) {
+    std::vector<factory_t> rules(count);
+
+    for(int i = 0; i < count; ++i) {
+      switch(i % 4) {
+      case 0: rules[i].construct<rule_match>(rule_match { { i }, "abc" }); break;
+      case 1: rules[i].construct<rule_range>(rule_range { { i }, -i, i }); break;
+      case 2: rules[i].construct<rule_flag >(rule_flag  { { }, { i }, true }); break;
+      default: break; // empty
+      }
+    }
+
+    return rules;
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(mapped_factory_array_suite)
+
+BOOST_AUTO_TEST_CASE(MappedRoundTrip) {
+  temp_file file;
+  std::vector<factory_t> rules = make_rules(1000);
+
+  array_t::save(file.path.c_str(), rules);
+  array_t mapped = array_t::open(file.path.c_str());
+
+  BOOST_REQUIRE_EQUAL(mapped.size(), 1000u);
+
+  bool equal = true;
+
+  for(std::size_t i = 0; i < rules.size(); ++i) {
+    equal = equal && mapped.index(i) == rules[i].index();
+
+    if(rules[i]) {
+      equal = equal && mapped[i].priority == static_cast<int>(i) && mapped.get_ptr(i)->priority == rules[i]->priority;
+    } else {
+      equal = equal && mapped.get_ptr(i) == nullptr;
+    }
+  }
+
+  BOOST_CHECK(equal);
+
+  BOOST_CHECK_EQUAL(std::string(mapped.get_if<rule_match>(4)->pattern), "abc");
+  BOOST_CHECK_EQUAL(mapped.get_if<rule_range>(5)->high, 5);
+  BOOST_CHECK      (mapped.get_if<rule_flag >(6)->value);
+  BOOST_CHECK      (mapped.get_if<rule_match>(5) == nullptr);
+
+  BOOST_CHECK_EQUAL(mapped.visit(9, [](auto const &obj) { return sizeof(obj); }), sizeof(rule_range));
+}
+
+BOOST_AUTO_TEST_CASE(MappedLoad) {
+  temp_file file;
+
+  array_t::save(file.path.c_str(), make_rules(8));
+  array_t mapped = array_t::open(file.path.c_str());
+
+  factory_t fct = mapped.load(2);
+  fct->priority = 20;
+
+  BOOST_CHECK_EQUAL(fct.index(), factory_t::index_of<rule_flag>);
+  BOOST_CHECK_EQUAL(fct->priority, 20);
+  BOOST_CHECK_EQUAL(mapped[2].priority, 2);
+
+  BOOST_CHECK(!mapped.load(3));
+}
+
+BOOST_AUTO_TEST_CASE(MappedEmpty) {
+  temp_file file;
+
+  array_t::save(file.path.c_str(), std::vector<factory_t>());
+  BOOST_CHECK(array_t::open(file.path.c_str()).empty());
+}
+
+BOOST_AUTO_TEST_CASE(MappedMismatch) {
+  temp_file file;
+
+  array_t::save(file.path.c_str(), make_rules(8));
+
+  typedef inplace::mapped_factory_array<rule_base, rule_match, rule_range> other_t;
+  BOOST_CHECK_THROW(other_t::open(file.path.c_str()), std::runtime_error);
+
+  // truncated
+  BOOST_REQUIRE_EQUAL(::truncate(file.path.c_str(), 100), 0);
+  BOOST_CHECK_THROW(array_t::open(file.path.c_str()), std::runtime_error);
+
+  BOOST_CHECK_THROW(array_t::open("/nonexistent/rules"), std::system_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
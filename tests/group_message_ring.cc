@@ -0,0 +1,157 @@
+#include <boost/test/unit_test.hpp>
+#include <inplace/message_ring.hh>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+  struct ring_base {
+    virtual ~ring_base() { }
+    virtual long val() const = 0;
+  };
+
+  class ring_value : public ring_base {
+  public:
+    ring_value(long x) : x_(x) { }
+    virtual long val() const { return x_; }
+
+  private:
+    long x_;
+  };
+
+  class ring_move_only : public ring_base {
+  public:
+    ring_move_only(long x) : x_(std::make_unique<long>(x)) { }
+    virtual long val() const { return *x_; }
+
+  private:
+    std::unique_ptr<long> x_;
+  };
+
+  struct ring_pinned : ring_base {
+    ring_pinned(long x) : x(x) { }
+    ring_pinned(ring_pinned const &) = delete;
+    ring_pinned(ring_pinned &&) = delete;
+
+    virtual long val() const { return x; }
+
+    long x;
+  };
+
+  struct ring_throwing : ring_base {
+    ring_throwing() { throw std::runtime_error("ring_throwing"); }
+    virtual long val() const { return 0; }
+  };
+
+  typedef inplace::message_ring<ring_base, ring_value, ring_move_only, ring_pinned, ring_throwing> ring_t;
+
+  long consume_val(ring_t &ring) {
+    long result = -1;
+    ring.try_consume([&](ring_base &msg) { result = msg.val(); });
+    return result;
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(message_ring_suite)
+
+BOOST_AUTO_TEST_CASE(MessageRingFifo) {
+  ring_t ring(3);
+
+  BOOST_CHECK_EQUAL(ring.capacity(), 4u);
+  BOOST_CHECK(!ring.try_consume([](ring_base &) { }));
+
+  BOOST_CHECK(ring.try_emplace<ring_value    >(1));
+  BOOST_CHECK(ring.try_emplace<ring_move_only>(2));
+  BOOST_CHECK(ring.try_emplace<ring_pinned   >(3));
+  BOOST_CHECK(ring.try_emplace<ring_value    >(4));
+  BOOST_CHECK(!ring.try_emplace<ring_value   >(5));
+
+  BOOST_CHECK_EQUAL(consume_val(ring), 1);
+  BOOST_CHECK_EQUAL(consume_val(ring), 2);
+
+  BOOST_CHECK(ring.try_emplace<ring_value>(6));
+
+  BOOST_CHECK_EQUAL(consume_val(ring), 3);
+  BOOST_CHECK_EQUAL(consume_val(ring), 4);
+  BOOST_CHECK_EQUAL(consume_val(ring), 6);
+  BOOST_CHECK_EQUAL(consume_val(ring), -1);
+}
+
+BOOST_AUTO_TEST_CASE(MessageRingConsumeFactory) {
+  ring_t ring(2);
+
+  ring.try_emplace<ring_pinned>(7);
+
+  bool consumed = ring.try_consume([](ring_t::factory_type &msg) {
+      BOOST_REQUIRE(msg.get_if<ring_pinned>() != nullptr);
+      BOOST_CHECK_EQUAL(msg.get_if<ring_pinned>()->x, 7);
+    });
+
+  BOOST_CHECK(consumed);
+}
+
+BOOST_AUTO_TEST_CASE(MessageRingThrowing) {
+  ring_t ring(2);
+
+  BOOST_CHECK_THROW(ring.try_emplace<ring_throwing>(), std::runtime_error);
+  BOOST_CHECK(ring.try_emplace<ring_value>(1));
+
+  // the failed message is skipped
+  BOOST_CHECK_EQUAL(consume_val(ring), 1);
+  BOOST_CHECK_EQUAL(consume_val(ring), -1);
+
+  // the consumer throwing still frees the slot
+  ring.try_emplace<ring_value>(2);
+  ring.try_emplace<ring_value>(3);
+
+  BOOST_CHECK_THROW(ring.try_consume([](ring_base &) { throw std::runtime_error("consumer"); }), std::runtime_error);
+  BOOST_CHECK(ring.try_emplace<ring_value>(4));
+  BOOST_CHECK_EQUAL(consume_val(ring), 3);
+  BOOST_CHECK_EQUAL(consume_val(ring), 4);
+}
+
+BOOST_AUTO_TEST_CASE(MessageRingConcurrent) {
+  constexpr long producers = 2;
+  constexpr long consumers = 2;
+  constexpr long per_producer = 20000;
+
+  ring_t ring(64);
+  std::atomic<long> sum      { 0 };
+  std::atomic<long> received { 0 };
+  std::vector<std::thread> threads;
+
+  for(long p = 0; p < producers; ++p) {
+    threads.emplace_back([&, p] {
+        for(long i = 1; i <= per_producer; ++i) {
+          bool ok = p == 0 ? ring.try_emplace<ring_move_only>(i) : ring.try_emplace<ring_value>(i);
+
+          while(!ok) {
+            std::this_thread::yield();
+            ok = p == 0 ? ring.try_emplace<ring_move_only>(i) : ring.try_emplace<ring_value>(i);
+          }
+        }
+      });
+  }
+
+  for(long c = 0; c < consumers; ++c) {
+    threads.emplace_back([&] {
+        while(received.load() < producers * per_producer) {
+          if(!ring.try_consume([&](ring_base &msg) { sum += msg.val(); ++received; })) {
+            std::this_thread::yield();
+          }
+        }
+      });
+  }
+
+  for(std::thread &t : threads) {
+    t.join();
+  }
+
+  BOOST_CHECK_EQUAL(received, producers * per_producer);
+  BOOST_CHECK_EQUAL(sum     , producers * per_producer * (per_producer + 1) / 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -12,7 +12,8 @@ namespace {
 
     MADE_WITH_DEFAULT,
     MADE_WITH_COPY,
-    MADE_WITH_MOVE
+    MADE_WITH_MOVE,
+    MADE_WITH_ASSIGN
   };
 
   struct mixed_base {
@@ -20,8 +21,8 @@ namespace {
     mixed_base(mixed_base const &) : made_with_(MADE_WITH_COPY   ) { }
     mixed_base(mixed_base      &&) : made_with_(MADE_WITH_MOVE   ) { }
 
-    mixed_base &operator=(mixed_base const &) { made_with_ = -1; return *this; }
-    mixed_base &operator=(mixed_base      &&) { made_with_ = -1; return *this; }
+    mixed_base &operator=(mixed_base const &) { made_with_ = MADE_WITH_ASSIGN; return *this; }
+    mixed_base &operator=(mixed_base      &&) { made_with_ = MADE_WITH_ASSIGN; return *this; }
 
     virtual ~mixed_base() { }
     virtual int val() const = 0;
@@ -147,7 +148,7 @@ BOOST_AUTO_TEST_CASE(mixed_copyables) {
   BOOST_REQUIRE(fct2);
   BOOST_CHECK_EQUAL(fct ->val      (), COPY_AND_MOVE);
   BOOST_CHECK_EQUAL(fct2->val      (), COPY_AND_MOVE);
-  BOOST_CHECK_EQUAL(fct ->made_with(), MADE_WITH_COPY);
+  BOOST_CHECK_EQUAL(fct ->made_with(), MADE_WITH_ASSIGN);
   BOOST_CHECK_EQUAL(fct2->made_with(), MADE_WITH_COPY);
 
   fct = std::move(fct2);
@@ -155,7 +156,7 @@ BOOST_AUTO_TEST_CASE(mixed_copyables) {
   BOOST_REQUIRE( fct );
   BOOST_REQUIRE(!fct2);
   BOOST_CHECK_EQUAL(fct ->val      (), COPY_AND_MOVE);
-  BOOST_CHECK_EQUAL(fct ->made_with(), MADE_WITH_MOVE);
+  BOOST_CHECK_EQUAL(fct ->made_with(), MADE_WITH_ASSIGN);
 
   factory_t fct3(std::move(fct));
 
@@ -181,6 +182,44 @@ BOOST_AUTO_TEST_CASE(mixed_copyables) {
   BOOST_CHECK_EQUAL(fct3->made_with(), MADE_WITH_COPY);
 }
 
+BOOST_AUTO_TEST_CASE(mixed_emplace_or_assign) {
+  typedef inplace::factory<mixed_base,
+                           mixed_copy_and_move,
+                           mixed_copy_only,
+                           mixed_move_only> factory_t;
+
+  factory_t fct;
+  fct.emplace_or_assign<mixed_copy_and_move>();
+
+  BOOST_REQUIRE(fct);
+  BOOST_CHECK_EQUAL(fct->made_with(), MADE_WITH_DEFAULT);
+
+  fct.emplace_or_assign<mixed_copy_and_move>(mixed_copy_and_move());
+
+  BOOST_REQUIRE(fct);
+  BOOST_CHECK_EQUAL(fct->val      (), COPY_AND_MOVE);
+  BOOST_CHECK_EQUAL(fct->made_with(), MADE_WITH_ASSIGN);
+
+  fct.emplace_or_assign<mixed_move_only>(mixed_move_only());
+
+  BOOST_REQUIRE(fct);
+  BOOST_CHECK_EQUAL(fct->val      (), MOVE_ONLY);
+  BOOST_CHECK_EQUAL(fct->made_with(), MADE_WITH_MOVE);
+
+  fct.emplace_or_assign<mixed_move_only>(mixed_move_only());
+
+  BOOST_CHECK_EQUAL(fct->made_with(), MADE_WITH_ASSIGN);
+
+  // first constructed by copy, then copy-assigned
+  mixed_copy_only const source;
+  fct.emplace_or_assign<mixed_copy_only>(source);
+  fct.emplace_or_assign<mixed_copy_only>(source);
+
+  BOOST_REQUIRE(fct);
+  BOOST_CHECK_EQUAL(fct->val      (), COPY_ONLY);
+  BOOST_CHECK_EQUAL(fct->made_with(), MADE_WITH_ASSIGN);
+}
+
 BOOST_AUTO_TEST_CASE(mixed_moveables) {
   typedef inplace::factory<mixed_base,
                            mixed_copy_and_move,
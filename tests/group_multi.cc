@@ -1,7 +1,10 @@
 #include <boost/test/unit_test.hpp>
 #include <inplace/factory.hh>
 
+#include <cstddef>
+#include <cstring>
 #include <memory>
+#include <new>
 #include <type_traits>
 #include <typeinfo>
 
@@ -137,6 +140,46 @@ BOOST_AUTO_TEST_CASE(MultiMoveAssign) {
   BOOST_CHECK_EQUAL(fct3->val(), SANDWICH);
 }
 
+BOOST_AUTO_TEST_CASE(MultiSwap) {
+  factory_t fct, fct2;
+
+  fct .construct<multi_sandwich>();
+  fct2.construct<multi_back    >();
+
+  swap(fct, fct2);
+
+  BOOST_REQUIRE(fct );
+  BOOST_REQUIRE(fct2);
+  BOOST_CHECK_EQUAL(fct ->val(), BACK    );
+  BOOST_CHECK_EQUAL(fct2->val(), SANDWICH);
+
+  fct.construct<multi_sandwich>();
+  swap(fct, fct2);
+
+  BOOST_REQUIRE(fct );
+  BOOST_REQUIRE(fct2);
+  BOOST_CHECK_EQUAL(fct ->val(), SANDWICH);
+  BOOST_CHECK_EQUAL(fct2->val(), SANDWICH);
+}
+
+BOOST_AUTO_TEST_CASE(MultiRelocateBytes) {
+  // the factory does not point into itself, so its bytes can be moved elsewhere.
+  alignas(factory_t) std::byte from[sizeof(factory_t)];
+  alignas(factory_t) std::byte to  [sizeof(factory_t)];
+
+  new(from) factory_t([](factory_t &f) { f.construct<multi_sandwich>(); });
+  std::memcpy(to, from, sizeof(factory_t));
+
+  factory_t &fct = *std::launder(reinterpret_cast<factory_t *>(to));
+  std::byte *obj = reinterpret_cast<std::byte *>(fct.get_ptr());
+
+  BOOST_REQUIRE(fct);
+  BOOST_CHECK  (obj >= to && obj < to + sizeof(factory_t));
+  BOOST_CHECK_EQUAL(fct->val(), SANDWICH);
+
+  fct.~factory_t();
+}
+
 BOOST_AUTO_TEST_CASE(MultiConstructReturnsNewObject) {
   factory_t fct;
   multi_base *ptr = nullptr;
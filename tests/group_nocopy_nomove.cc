@@ -54,4 +54,9 @@ BOOST_AUTO_TEST_CASE(NoCopyNoMoveMoveAssign) {
   BOOST_CHECK(!std::is_move_assignable<factory_t>::value);
 }
 
+BOOST_AUTO_TEST_CASE(NoCopyNoMoveSize) {
+  // the storage and the pointer to the operations table, nothing else
+  BOOST_CHECK_EQUAL(sizeof(factory_t), sizeof(nocopy_nomove_x) + sizeof(void *));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -168,6 +168,40 @@ BOOST_AUTO_TEST_CASE(PlainMoveAssign) {
   BOOST_CHECK_EQUAL(fct ->val(), 10);
 }
 
+BOOST_AUTO_TEST_CASE(PlainSwap) {
+  factory_t fct, fct2;
+
+  fct .construct<plain_child_x>(10);
+  fct2.construct<plain_child_x>(20);
+
+  swap(fct, fct2);
+
+  BOOST_REQUIRE(fct );
+  BOOST_REQUIRE(fct2);
+  BOOST_CHECK_EQUAL(fct ->val(), 20);
+  BOOST_CHECK_EQUAL(fct2->val(), 10);
+
+  fct2.construct<plain_child_1>();
+  fct.swap(fct2);
+
+  BOOST_REQUIRE(fct );
+  BOOST_REQUIRE(fct2);
+  BOOST_CHECK_EQUAL(fct ->val(),  1);
+  BOOST_CHECK_EQUAL(fct2->val(), 20);
+
+  fct2.clear();
+  fct.swap(fct2);
+
+  BOOST_CHECK  (!fct );
+  BOOST_REQUIRE( fct2);
+  BOOST_CHECK_EQUAL(fct2->val(), 1);
+
+  fct2.swap(fct2);
+
+  BOOST_REQUIRE(fct2);
+  BOOST_CHECK_EQUAL(fct2->val(), 1);
+}
+
 BOOST_AUTO_TEST_CASE(PlainConstruct) {
   factory_t fct;
 
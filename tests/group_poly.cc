@@ -0,0 +1,132 @@
+#include <boost/test/unit_test.hpp>
+#include <inplace/poly.hh>
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace {
+  struct poly_base {
+    virtual ~poly_base() { }
+    virtual int val() const = 0;
+  };
+
+  struct poly_child_1 : poly_base { virtual int val() const { return 1; } };
+
+  class poly_child_x : public poly_base {
+  public:
+    poly_child_x(int x) : x_(x) { }
+    virtual int val() const { return x_; }
+
+  private:
+    int x_;
+  };
+
+  // base is not the first base class, so the base subobject is not at the start of the object
+  struct poly_padding { int pad[3] = { 7, 8, 9 }; virtual ~poly_padding() { } };
+
+  struct poly_child_multi : poly_padding, poly_base {
+    virtual int val() const { return pad[2]; }
+  };
+
+  class poly_child_moveonly : public poly_base {
+  public:
+    poly_child_moveonly(int x) : x_(std::make_unique<int>(x)) { }
+    virtual int val() const { return x_ ? *x_ : 0; }
+
+  private:
+    std::unique_ptr<int> x_;
+  };
+
+  typedef inplace::poly<poly_base, 64>                   poly_t;
+  typedef inplace::poly<poly_base, 64, 16, false>        poly_moveonly_t;
+  typedef inplace::poly<poly_base, 64, 16, false, false> poly_pinned_t;
+}
+
+BOOST_AUTO_TEST_SUITE(poly_suite)
+
+BOOST_AUTO_TEST_CASE(PolySemantics) {
+  BOOST_CHECK( std::is_copy_constructible<poly_t         >::value);
+  BOOST_CHECK( std::is_move_constructible<poly_t         >::value);
+  BOOST_CHECK(!std::is_copy_constructible<poly_moveonly_t>::value);
+  BOOST_CHECK( std::is_move_constructible<poly_moveonly_t>::value);
+  BOOST_CHECK(!std::is_copy_constructible<poly_pinned_t  >::value);
+  BOOST_CHECK(!std::is_move_constructible<poly_pinned_t  >::value);
+}
+
+BOOST_AUTO_TEST_CASE(PolyConstruct) {
+  poly_t p;
+
+  BOOST_CHECK(!p);
+
+  p.construct<poly_child_x>(10);
+
+  BOOST_REQUIRE(p);
+  BOOST_CHECK  (p->val() == 10);
+
+  p.construct<poly_child_multi>();
+
+  BOOST_REQUIRE(p);
+  BOOST_CHECK  (p->val() == 9);
+
+  p.clear();
+
+  BOOST_CHECK(!p);
+}
+
+BOOST_AUTO_TEST_CASE(PolyInPlaceCtor) {
+  poly_t p(std::in_place_type<poly_child_x>, 3);
+
+  BOOST_REQUIRE(p);
+  BOOST_CHECK  (p->val() == 3);
+}
+
+BOOST_AUTO_TEST_CASE(PolyCopy) {
+  poly_t p(std::in_place_type<poly_child_multi>);
+  poly_t q(p);
+
+  BOOST_REQUIRE(p);
+  BOOST_REQUIRE(q);
+  BOOST_CHECK  (q->val() == 9);
+  BOOST_CHECK  (q.get_ptr() != p.get_ptr());
+
+  q = poly_t(std::in_place_type<poly_child_1>);
+
+  BOOST_REQUIRE(q);
+  BOOST_CHECK  (q->val() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(PolyMoveOnly) {
+  poly_moveonly_t p(std::in_place_type<poly_child_moveonly>, 5);
+  poly_moveonly_t q(std::move(p));
+
+  BOOST_CHECK  (!p);
+  BOOST_REQUIRE(q);
+  BOOST_CHECK  (q->val() == 5);
+}
+
+BOOST_AUTO_TEST_CASE(PolyGetIf) {
+  poly_t p(std::in_place_type<poly_child_x>, 4);
+
+  BOOST_REQUIRE(p.get_if<poly_child_x>() != nullptr);
+  BOOST_CHECK  (p.get_if<poly_child_x>()->val() == 4);
+  BOOST_CHECK  (p.get_if<poly_child_1>() == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(PolySwap) {
+  poly_t p(std::in_place_type<poly_child_x>, 1);
+  poly_t q(std::in_place_type<poly_child_multi>);
+  poly_t r(std::in_place_type<poly_child_x>, 2);
+
+  swap(p, q);
+
+  BOOST_CHECK(p->val() == 9);
+  BOOST_CHECK(q->val() == 1);
+
+  swap(q, r);
+
+  BOOST_CHECK(q->val() == 2);
+  BOOST_CHECK(r->val() == 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,106 @@
+#include <boost/test/unit_test.hpp>
+#include <inplace/poly_collection.hh>
+
+#include <string>
+#include <vector>
+
+namespace {
+  struct coll_base {
+    virtual ~coll_base() { }
+    virtual int val() const = 0;
+  };
+
+  struct coll_one final : coll_base {
+    int val() const override { return 1; }
+  };
+
+  struct coll_x final : coll_base {
+    coll_x(int x) : x_(x) { }
+    int val() const override { return x_; }
+
+    int x_;
+  };
+
+  struct coll_name final : coll_base {
+    coll_name(std::string name) : name_(std::move(name)) { }
+    int val() const override { return static_cast<int>(name_.size()); }
+
+    std::string name_;
+  };
+
+  typedef inplace::poly_collection<coll_base,
+                                   coll_one,
+                                   coll_x,
+                                   coll_name> collection_t;
+}
+
+BOOST_AUTO_TEST_SUITE(poly_collection_suite)
+
+BOOST_AUTO_TEST_CASE(CollectionEmpty) {
+  collection_t coll;
+
+  BOOST_CHECK(coll.empty());
+  BOOST_CHECK_EQUAL(coll.size(), 0u);
+
+  int calls = 0;
+  coll.for_each([&](auto &) { ++calls; });
+  BOOST_CHECK_EQUAL(calls, 0);
+}
+
+BOOST_AUTO_TEST_CASE(CollectionEmplace) {
+  collection_t coll;
+
+  coll.emplace<coll_x>(10);
+  coll.emplace<coll_name>("foo");
+  coll.emplace<coll_one>();
+  coll.emplace<coll_x>(20);
+
+  BOOST_CHECK(!coll.empty());
+  BOOST_CHECK_EQUAL(coll.size(), 4u);
+  BOOST_CHECK_EQUAL(coll.segment<coll_one >().size(), 1u);
+  BOOST_CHECK_EQUAL(coll.segment<coll_x   >().size(), 2u);
+  BOOST_CHECK_EQUAL(coll.segment<coll_name>().size(), 1u);
+
+  coll_x &x = coll.emplace<coll_x>(30);
+  BOOST_CHECK_EQUAL(x.val(), 30);
+  BOOST_CHECK_EQUAL(&x, &coll.segment<coll_x>().back());
+}
+
+BOOST_AUTO_TEST_CASE(CollectionForEachBySegment) {
+  collection_t coll;
+
+  coll.emplace<coll_x>(10);
+  coll.emplace<coll_name>("foo");
+  coll.emplace<coll_one>();
+  coll.emplace<coll_x>(20);
+
+  std::vector<int> vals;
+  coll.for_each([&](auto &obj) { vals.push_back(obj.val()); });
+
+  BOOST_CHECK((vals == std::vector<int>{ 1, 10, 20, 3 }));
+
+  coll.for_each([](auto &obj) {
+      if constexpr(std::is_same_v<std::remove_cvref_t<decltype(obj)>, coll_x>) {
+        obj.x_ *= 2;
+      }
+    });
+
+  int sum = 0;
+  collection_t const &ccoll = coll;
+  ccoll.for_each([&](coll_base const &obj) { sum += obj.val(); });
+
+  BOOST_CHECK_EQUAL(sum, 1 + 20 + 40 + 3);
+}
+
+BOOST_AUTO_TEST_CASE(CollectionClear) {
+  collection_t coll;
+
+  coll.emplace<coll_one>();
+  coll.emplace<coll_name>("bar");
+  coll.clear();
+
+  BOOST_CHECK(coll.empty());
+  BOOST_CHECK_EQUAL(coll.size(), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,162 @@
+#include <boost/test/unit_test.hpp>
+#include <inplace/poly_stack.hh>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+  std::vector<int> stack_destroyed;
+
+  struct stack_base {
+    virtual ~stack_base() { }
+    virtual int val() const = 0;
+  };
+
+  class stack_child_x : public stack_base {
+  public:
+    stack_child_x(int x) : x_(x) { }
+    virtual ~stack_child_x() { stack_destroyed.push_back(x_); }
+    virtual int val() const { return x_; }
+
+  private:
+    int x_;
+  };
+
+  struct stack_filler { char padding[12]; virtual ~stack_filler() { } };
+
+  // base_type is not the first base class
+  struct stack_child_multi : stack_filler, stack_base {
+    stack_child_multi(std::string s) : s(std::move(s)) { }
+    virtual int val() const { return static_cast<int>(s.size()); }
+
+    std::string s;
+  };
+
+  // no virtual destructor in this hierarchy, nothing to destroy
+  struct stack_plain_base { int x; };
+  struct alignas(64) stack_plain : stack_plain_base { };
+
+  // over-aligned and not trivially destructible: the object is further from its record than the record's size
+  struct alignas(64) stack_aligned : stack_base {
+    stack_aligned(std::string s) : s(std::move(s)) { }
+    virtual ~stack_aligned() { stack_destroyed.push_back(static_cast<int>(s.size())); }
+    virtual int val() const { return static_cast<int>(s.size()); }
+
+    std::string s;
+  };
+
+  struct stack_big : stack_base {
+    virtual int val() const { return 42; }
+    char payload[10000];
+  };
+
+  struct stack_throwing : stack_base {
+    stack_throwing() { throw std::runtime_error("stack_throwing"); }
+    virtual int val() const { return 0; }
+  };
+
+  typedef inplace::poly_stack<stack_base> stack_t;
+}
+
+BOOST_AUTO_TEST_SUITE(poly_stack_suite)
+
+BOOST_AUTO_TEST_CASE(PolyStackEmplace) {
+  stack_t stack(256);
+
+  stack_base *a = stack.emplace<stack_child_x    >(1);
+  stack_base *b = stack.emplace<stack_child_multi>("hello");
+  stack_base *c = stack.emplace<stack_big        >();
+
+  BOOST_CHECK_EQUAL(a->val(), 1);
+  BOOST_CHECK_EQUAL(b->val(), 5);
+  BOOST_CHECK_EQUAL(c->val(), 42);
+}
+
+BOOST_AUTO_TEST_CASE(PolyStackReleaseOrder) {
+  stack_destroyed.clear();
+
+  {
+    stack_t stack(128);
+
+    for(int i = 0; i < 20; ++i) {
+      stack.emplace<stack_child_x>(i);
+    }
+
+    stack.release();
+
+    BOOST_REQUIRE_EQUAL(stack_destroyed.size(), 20u);
+    for(int i = 0; i < 20; ++i) {
+      BOOST_CHECK_EQUAL(stack_destroyed[i], 19 - i);
+    }
+
+    stack_destroyed.clear();
+    stack.emplace<stack_child_x>(100);
+  }
+
+  // the destructor releases as well
+  BOOST_CHECK((stack_destroyed == std::vector<int>{ 100 }));
+}
+
+BOOST_AUTO_TEST_CASE(PolyStackTrivial) {
+  inplace::poly_stack<stack_plain_base> stack(1024);
+
+  stack_plain *a = stack.emplace<stack_plain>();
+  stack_plain *b = stack.emplace<stack_plain>();
+
+  BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(a) % 64, 0u);
+  BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(b) % 64, 0u);
+
+  // no destructor record in between
+  BOOST_CHECK_EQUAL(reinterpret_cast<char *>(b) - reinterpret_cast<char *>(a), 64);
+}
+
+BOOST_AUTO_TEST_CASE(PolyStackOverAligned) {
+  stack_destroyed.clear();
+
+  {
+    // small objects in between move the aligned ones to every position in the chunks, including the last
+    // bytes of a chunk where a reservation without the gap after the record would run past its end
+    stack_t stack(256);
+
+    for(int i = 0; i < 40; ++i) {
+      stack_base *obj = stack.emplace<stack_aligned>(std::string(40 + i, 'x'));
+
+      BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(obj) % 64, 0u);
+      BOOST_CHECK_EQUAL(obj->val(), 40 + i);
+
+      for(int j = 0; j < i % 4; ++j) {
+        stack.emplace<stack_child_multi>("");
+      }
+    }
+
+    stack.release();
+
+    BOOST_REQUIRE_EQUAL(stack_destroyed.size(), 40u);
+    for(int i = 0; i < 40; ++i) {
+      BOOST_CHECK_EQUAL(stack_destroyed[i], 79 - i);
+    }
+
+    stack_destroyed.clear();
+    stack.emplace<stack_aligned>("abc");
+  }
+
+  BOOST_CHECK((stack_destroyed == std::vector<int>{ 3 }));
+}
+
+BOOST_AUTO_TEST_CASE(PolyStackThrowing) {
+  stack_destroyed.clear();
+
+  {
+    stack_t stack(256);
+
+    stack.emplace<stack_child_x>(1);
+    BOOST_CHECK_THROW(stack.emplace<stack_throwing>(), std::runtime_error);
+    stack.emplace<stack_child_x>(2);
+  }
+
+  BOOST_CHECK((stack_destroyed == std::vector<int>{ 2, 1 }));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,111 @@
+#include <boost/test/unit_test.hpp>
+#include <inplace/factory.hh>
+#include <inplace/seqlock_factory.hh>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+  enum {
+    QUOTE,
+    READING
+  };
+
+  struct seqlock_base {
+    int kind;
+  };
+
+  // bid and ask are always written as a pair that a torn read would break up
+  struct seqlock_quote : seqlock_base {
+    seqlock_quote(long bid) : seqlock_base{QUOTE}, bid(bid), ask(bid + 1) { }
+
+    long bid;
+    long ask;
+  };
+
+  struct seqlock_padding { char padding[20]; };
+
+  struct seqlock_reading : seqlock_padding, seqlock_base {
+    seqlock_reading(long value) : seqlock_padding{}, seqlock_base{READING}, value(value), check(~value) { }
+
+    long value;
+    long check;
+  };
+
+  typedef inplace::factory<seqlock_base, seqlock_quote, seqlock_reading> factory_t;
+
+  bool consistent(factory_t const &fct) {
+    if(auto q = fct.get_if<seqlock_quote>()) {
+      return q->kind == QUOTE && q->ask == q->bid + 1;
+    } else if(auto r = fct.get_if<seqlock_reading>()) {
+      return r->kind == READING && r->check == ~r->value;
+    }
+
+    return false;
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(seqlock_factory_suite)
+
+BOOST_AUTO_TEST_CASE(SeqlockFactoryLoad) {
+  inplace::seqlock_factory<factory_t> sf;
+
+  BOOST_CHECK(!sf.load());
+
+  sf.construct<seqlock_quote>(10);
+
+  factory_t fct = sf.load();
+
+  BOOST_REQUIRE(fct);
+  BOOST_CHECK_EQUAL(fct->kind, QUOTE);
+  BOOST_CHECK_EQUAL(fct.get_if<seqlock_quote>()->ask, 11);
+
+  sf.construct<seqlock_reading>(5);
+  fct = sf.load();
+
+  BOOST_REQUIRE(fct);
+  BOOST_CHECK_EQUAL(fct->kind, READING);
+  BOOST_CHECK_EQUAL(fct.get_if<seqlock_reading>()->value, 5);
+
+  sf.clear();
+
+  BOOST_CHECK(!sf.load());
+}
+
+BOOST_AUTO_TEST_CASE(SeqlockFactoryConcurrentReaders) {
+  inplace::seqlock_factory<factory_t> sf;
+  sf.construct<seqlock_quote>(0);
+
+  std::atomic<bool> done   { false };
+  std::atomic<int>  broken { 0 };
+  std::vector<std::thread> readers;
+
+  for(int i = 0; i < 4; ++i) {
+    readers.emplace_back([&] {
+        while(!done.load(std::memory_order_relaxed)) {
+          if(!consistent(sf.load())) {
+            ++broken;
+          }
+        }
+      });
+  }
+
+  for(long i = 1; i <= 20000; ++i) {
+    if(i % 2 == 0) {
+      sf.construct<seqlock_quote>(i);
+    } else {
+      sf.construct<seqlock_reading>(i);
+    }
+  }
+
+  done = true;
+
+  for(std::thread &t : readers) {
+    t.join();
+  }
+
+  BOOST_CHECK_EQUAL(broken, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
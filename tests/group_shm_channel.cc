@@ -0,0 +1,194 @@
+#include <boost/test/unit_test.hpp>
+#include <inplace/shm_channel.hh>
+
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+  enum {
+    QUOTE,
+    TRADE
+  };
+
+  struct shm_base {
+    int kind;
+  };
+
+  struct shm_quote : shm_base {
+    shm_quote(long bid) : shm_base{QUOTE}, bid(bid), ask(bid + 1) { }
+
+    long bid;
+    long ask;
+  };
+
+  struct shm_trade : shm_base {
+    shm_trade(long px, int qty) : shm_base{TRADE}, px(px), qty(qty) { }
+
+    long px;
+    int  qty;
+    char venue[40] = "XETR";
+  };
+
+  // Only 4-byte alignment, so records are not naturally multiples of a record header.
+  struct shm_flag : shm_base { };
+  struct shm_tick : shm_base { int seq, size; };
+
+  typedef inplace::shm_channel<shm_base, shm_quote, shm_trade> channel_t;
+  typedef inplace::shm_channel<shm_base, shm_flag, shm_tick> int_channel_t;
+
+  // Records of 16 and 56 bytes: the large one is more than half of a ring sized for one of it.
+  struct shm_block : shm_base { int values[10]; };
+
+  typedef inplace::shm_channel<shm_base, shm_flag, shm_block> block_channel_t;
+  typedef inplace::shm_channel<shm_base, shm_trade, shm_quote> other_channel_t;
+}
+
+BOOST_AUTO_TEST_SUITE(shm_channel_suite)
+
+BOOST_AUTO_TEST_CASE(ShmChannelTwoMappings) {
+  channel_t producer = channel_t::create(4096);
+  channel_t consumer = channel_t::attach(producer.fd());
+
+  BOOST_CHECK_EQUAL(consumer.capacity(), producer.capacity());
+
+  BOOST_CHECK(producer.try_emplace<shm_quote>(10));
+  BOOST_CHECK(producer.try_emplace<shm_trade>(20, 5));
+
+  std::vector<long> values;
+  std::vector<void const *> addresses;
+
+  std::size_t n = consumer.consume([&]<typename T>(T const &msg) {
+      addresses.push_back(&msg);
+
+      if constexpr(std::is_same_v<T, shm_quote>) {
+        BOOST_CHECK_EQUAL(msg.kind, QUOTE);
+        values.push_back(msg.ask);
+      } else {
+        BOOST_CHECK_EQUAL(msg.kind, TRADE);
+        BOOST_CHECK_EQUAL(msg.venue, "XETR");
+        values.push_back(msg.px * msg.qty);
+      }
+    });
+
+  BOOST_CHECK_EQUAL(n, 2u);
+  BOOST_CHECK((values == std::vector<long>{ 11, 100 }));
+  BOOST_CHECK(producer.empty());
+}
+
+BOOST_AUTO_TEST_CASE(ShmChannelWrapAroundSmallAlignment) {
+  int_channel_t producer = int_channel_t::create(64);
+  int_channel_t consumer = int_channel_t::attach(producer.fd());
+
+  int next = 0;
+  int expected = 0;
+  bool ordered = true;
+
+  for(int round = 0; round < 100; ++round) {
+    // with 12- and 20-byte records in this pattern, the ring wraps with only 4 bytes left at its end
+    while(next % 7 == 0 ? producer.try_emplace<shm_tick>(shm_tick { { next }, next, 1 })
+                        : producer.try_emplace<shm_flag>(shm_flag { { next } })) {
+      ++next;
+    }
+
+    consumer.consume([&](shm_base const &msg) {
+        ordered = ordered && msg.kind == expected;
+        ++expected;
+      });
+  }
+
+  BOOST_CHECK(ordered);
+  BOOST_CHECK_EQUAL(next, expected);
+  BOOST_CHECK(next > 100);
+
+  // nothing was written past the end of the ring, i.e. past the end of the file
+  struct stat st;
+  BOOST_REQUIRE_EQUAL(::fstat(producer.fd(), &st), 0);
+
+  std::size_t size      = static_cast<std::size_t>(st.st_size);
+  std::size_t page      = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+  std::size_t map_size  = (size + page - 1) / page * page;
+  void       *mapping   = ::mmap(nullptr, map_size, PROT_READ, MAP_SHARED, producer.fd(), 0);
+
+  BOOST_REQUIRE(mapping != MAP_FAILED);
+
+  unsigned char const *bytes = static_cast<unsigned char const *>(mapping);
+  bool clean = true;
+
+  for(std::size_t i = size; i < map_size; ++i) {
+    clean = clean && bytes[i] == 0;
+  }
+
+  ::munmap(mapping, map_size);
+  BOOST_CHECK(clean);
+}
+
+BOOST_AUTO_TEST_CASE(ShmChannelLargeRecordAfterWrap) {
+  block_channel_t producer = block_channel_t::create(64);
+  block_channel_t consumer = block_channel_t::attach(producer.fd());
+
+  // head at every record boundary in the buffer, nothing queued
+  bool fits = true;
+
+  for(int i = 0; i < 8; ++i) {
+    BOOST_REQUIRE(producer.try_emplace<shm_flag>(shm_flag { { i } }));
+    BOOST_CHECK_EQUAL(consumer.consume([](shm_base const &) { }), 1u);
+    BOOST_REQUIRE(producer.empty());
+
+    // the padding up to the end of the buffer and the record fit into an empty channel
+    fits = fits && producer.try_emplace<shm_block>(shm_block { { i }, { } });
+    consumer.consume([](shm_base const &) { });
+  }
+
+  BOOST_CHECK(fits);
+}
+
+BOOST_AUTO_TEST_CASE(ShmChannelMismatch) {
+  channel_t channel = channel_t::create(4096);
+
+  BOOST_CHECK_THROW(other_channel_t::attach(channel.fd()), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(ShmChannelFork) {
+  constexpr long count = 50000;
+
+  channel_t consumer = channel_t::create(4096);
+  pid_t pid = ::fork();
+
+  BOOST_REQUIRE(pid != -1);
+
+  if(pid == 0) {
+    channel_t producer = channel_t::attach(consumer.fd());
+
+    for(long i = 0; i < count; ++i) {
+      while(!(i % 3 == 0 ? producer.try_emplace<shm_trade>(i, 1) : producer.try_emplace<shm_quote>(i))) {
+        ::sched_yield();
+      }
+    }
+
+    ::_exit(0);
+  }
+
+  long received = 0;
+  long sum = 0;
+
+  while(received < count) {
+    consumer.consume([&](shm_base const &msg) {
+        sum += msg.kind == QUOTE ? static_cast<shm_quote const &>(msg).bid : static_cast<shm_trade const &>(msg).px;
+        ++received;
+      });
+  }
+
+  int status = 0;
+  ::waitpid(pid, &status, 0);
+
+  BOOST_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  BOOST_CHECK_EQUAL(sum, count * (count - 1) / 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
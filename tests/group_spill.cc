@@ -0,0 +1,191 @@
+#include <boost/test/unit_test.hpp>
+#include <inplace/factory.hh>
+
+#include <cstddef>
+#include <memory_resource>
+#include <stdexcept>
+#include <type_traits>
+
+namespace {
+  // Counts allocations so the tests can see what is spilled.
+  class counting_resource : public std::pmr::memory_resource {
+  public:
+    std::size_t allocations   = 0;
+    std::size_t deallocations = 0;
+
+  private:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+      ++allocations;
+      return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {
+      ++deallocations;
+      std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(memory_resource const &other) const noexcept override {
+      return this == &other;
+    }
+  };
+
+  counting_resource spill_resource;
+
+  struct spill_resource_provider {
+    static std::pmr::memory_resource *get() noexcept { return &spill_resource; }
+  };
+
+  struct spill_base {
+    virtual ~spill_base() { }
+    virtual int val() const = 0;
+  };
+
+  struct spill_small : spill_base {
+    spill_small(int x) : x_(x) { }
+    int val() const override { return x_; }
+
+    int x_;
+  };
+
+  struct filler { char padding[256]; };
+
+  // base_type is not the first base, so the spilled object's base subobject is not at its start.
+  struct spill_large : filler, spill_base {
+    spill_large(int x) : filler{}, x_(x) { }
+    spill_large(spill_large const &other) : filler(other), x_(other.x_) { }
+
+    // not movable, so moving a factory has to hand over the pointer
+    spill_large(spill_large &&) = delete;
+
+    int val() const override { return x_; }
+
+    int x_;
+  };
+
+  struct spill_throwing : filler, spill_base {
+    spill_throwing() { throw std::runtime_error("spill_throwing"); }
+    spill_throwing(spill_throwing const &) = default;
+    int val() const override { return -1; }
+  };
+
+  typedef inplace::basic_factory<inplace::spill_storage<64, spill_resource_provider>,
+                                 spill_base,
+                                 spill_small,
+                                 spill_large,
+                                 spill_throwing> factory_t;
+
+  typedef inplace::factory<spill_base,
+                           spill_small,
+                           spill_large,
+                           spill_throwing> inline_factory_t;
+
+  struct spill_fixture {
+    spill_fixture() {
+      spill_resource.allocations   = 0;
+      spill_resource.deallocations = 0;
+    }
+
+    ~spill_fixture() {
+      BOOST_CHECK_EQUAL(spill_resource.allocations, spill_resource.deallocations);
+    }
+  };
+}
+
+BOOST_FIXTURE_TEST_SUITE(spill_suite, spill_fixture)
+
+BOOST_AUTO_TEST_CASE(SpillProperties) {
+  BOOST_CHECK(std::is_copy_constructible<factory_t>::value);
+  BOOST_CHECK(std::is_move_constructible<factory_t>::value);
+  BOOST_CHECK_LT(sizeof(factory_t), sizeof(spill_large));
+  BOOST_CHECK_LT(sizeof(factory_t), sizeof(inline_factory_t));
+}
+
+BOOST_AUTO_TEST_CASE(SpillConstruct) {
+  factory_t fct;
+
+  fct.construct<spill_small>(1);
+
+  BOOST_REQUIRE(fct);
+  BOOST_CHECK_EQUAL(fct->val(), 1);
+  BOOST_CHECK_EQUAL(spill_resource.allocations, 0u);
+
+  spill_base *obj = fct.construct<spill_large>(2);
+
+  BOOST_REQUIRE(fct);
+  BOOST_CHECK_EQUAL(obj, fct.get_ptr());
+  BOOST_CHECK_EQUAL(fct->val(), 2);
+  BOOST_CHECK_EQUAL(fct.visit([](auto &x) { return static_cast<spill_base &>(x).val(); }), 2);
+  BOOST_CHECK_EQUAL(fct.get_if<spill_large>()->x_, 2);
+  BOOST_CHECK_EQUAL(spill_resource.allocations, 1u);
+
+  fct.construct<spill_small>(3);
+
+  BOOST_CHECK_EQUAL(fct->val(), 3);
+  BOOST_CHECK_EQUAL(spill_resource.deallocations, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(SpillCopy) {
+  factory_t fct;
+  fct.construct<spill_large>(10);
+
+  factory_t fct2(fct);
+
+  BOOST_REQUIRE(fct );
+  BOOST_REQUIRE(fct2);
+  BOOST_CHECK_EQUAL(fct ->val(), 10);
+  BOOST_CHECK_EQUAL(fct2->val(), 10);
+  BOOST_CHECK_NE   (fct.get_ptr(), fct2.get_ptr());
+  BOOST_CHECK_EQUAL(spill_resource.allocations, 2u);
+}
+
+BOOST_AUTO_TEST_CASE(SpillMove) {
+  factory_t fct;
+  spill_base *obj = fct.construct<spill_large>(10);
+
+  factory_t fct2(std::move(fct));
+
+  BOOST_CHECK  (!fct );
+  BOOST_REQUIRE( fct2);
+  BOOST_CHECK_EQUAL(fct2.get_ptr(), obj);
+  BOOST_CHECK_EQUAL(fct2->val(), 10);
+
+  factory_t fct3;
+  fct3.construct<spill_small>(1);
+  fct3 = std::move(fct2);
+
+  BOOST_CHECK  (!fct2);
+  BOOST_REQUIRE( fct3);
+  BOOST_CHECK_EQUAL(fct3.get_ptr(), obj);
+  BOOST_CHECK_EQUAL(spill_resource.allocations, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(SpillSwap) {
+  factory_t fct, fct2;
+
+  spill_base *obj  = fct .construct<spill_large>(1);
+  spill_base *obj2 = fct2.construct<spill_large>(2);
+
+  swap(fct, fct2);
+
+  BOOST_CHECK_EQUAL(fct .get_ptr(), obj2);
+  BOOST_CHECK_EQUAL(fct2.get_ptr(), obj );
+  BOOST_CHECK_EQUAL(fct ->val(), 2);
+  BOOST_CHECK_EQUAL(fct2->val(), 1);
+
+  fct.construct<spill_small>(3);
+  swap(fct, fct2);
+
+  BOOST_CHECK_EQUAL(fct ->val(), 1);
+  BOOST_CHECK_EQUAL(fct2->val(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(SpillException) {
+  factory_t fct;
+  fct.construct<spill_large>(1);
+
+  BOOST_CHECK_THROW(fct.construct<spill_throwing>(), std::runtime_error);
+  BOOST_CHECK(!fct);
+  BOOST_CHECK_EQUAL(spill_resource.allocations, 2u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
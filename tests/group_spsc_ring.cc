@@ -0,0 +1,243 @@
+#include <boost/test/unit_test.hpp>
+#include <inplace/spsc_ring.hh>
+
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace {
+  int spsc_alive = 0;
+
+  struct spsc_base {
+    spsc_base() { ++spsc_alive; }
+    spsc_base(spsc_base const &) = delete;
+    ~spsc_base() { --spsc_alive; }
+
+    long val() const { return x; }
+
+    long x = 0;
+  };
+
+  struct spsc_small : spsc_base {
+    spsc_small(long v) { x = v; }
+  };
+
+  struct spsc_large : spsc_base {
+    spsc_large(long v) { x = v; payload[0] = static_cast<char>(v); }
+    char payload[200];
+  };
+
+  struct alignas(32) spsc_aligned : spsc_base {
+    spsc_aligned(long v) { x = v; }
+  };
+
+  typedef inplace::spsc_ring<spsc_base, spsc_small, spsc_large, spsc_aligned> ring_t;
+
+  // Only 4-byte alignment, so records are not naturally multiples of a header.
+  struct spsc_int_base { int x; };
+  struct spsc_int_one   : spsc_int_base { };
+  struct spsc_int_three : spsc_int_base { int y, z; };
+
+  typedef inplace::spsc_ring<spsc_int_base, spsc_int_one, spsc_int_three> int_ring_t;
+
+  // Records of 16 and 72 bytes: the large one is more than half of a ring sized for one of it.
+  struct spsc_word_base  { std::uint64_t x; };
+  struct spsc_word_one   : spsc_word_base { };
+  struct spsc_word_eight : spsc_word_base { std::uint64_t y[7]; };
+
+  typedef inplace::spsc_ring<spsc_word_base, spsc_word_one, spsc_word_eight> word_ring_t;
+
+  std::vector<long> drain(ring_t &ring) {
+    std::vector<long> result;
+    ring.consume([&](spsc_base &obj) { result.push_back(obj.val()); });
+    return result;
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(spsc_ring_suite)
+
+BOOST_AUTO_TEST_CASE(SpscRingPacking) {
+  ring_t ring(1024);
+
+  BOOST_CHECK_EQUAL(ring.capacity(), 1024u);
+
+  // small records take far less room than a slot sized for spsc_large would
+  int n = 0;
+  while(ring.try_emplace<spsc_small>(n)) {
+    ++n;
+  }
+
+  BOOST_CHECK(n >= 4 * static_cast<int>(1024 / sizeof(spsc_large)));
+  BOOST_CHECK_EQUAL(spsc_alive, n);
+
+  BOOST_CHECK_EQUAL(ring.consume([](spsc_base &) { }), static_cast<std::size_t>(n));
+  BOOST_CHECK_EQUAL(spsc_alive, 0);
+  BOOST_CHECK      (ring.empty());
+}
+
+BOOST_AUTO_TEST_CASE(SpscRingConcreteTypes) {
+  ring_t ring(1024);
+
+  ring.try_emplace<spsc_small  >(1);
+  ring.try_emplace<spsc_large  >(2);
+  ring.try_emplace<spsc_aligned>(3);
+
+  std::vector<int> kinds;
+
+  ring.consume([&]<typename T>(T &obj) {
+      if constexpr(std::is_same_v<T, spsc_small>) {
+        kinds.push_back(1);
+      } else if constexpr(std::is_same_v<T, spsc_large>) {
+        kinds.push_back(2);
+        BOOST_CHECK_EQUAL(obj.payload[0], 2);
+      } else {
+        kinds.push_back(3);
+        BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(&obj) % 32, 0u);
+      }
+    });
+
+  BOOST_CHECK((kinds == std::vector<int>{ 1, 2, 3 }));
+}
+
+BOOST_AUTO_TEST_CASE(SpscRingWrapAround) {
+  ring_t ring(512);
+
+  long next = 0;
+  long expected = 0;
+
+  for(int round = 0; round < 50; ++round) {
+    while(ring.try_emplace<spsc_large>(next)) {
+      ++next;
+
+      if(!ring.try_emplace<spsc_small>(next)) {
+        break;
+      }
+
+      ++next;
+    }
+
+    for(long v : drain(ring)) {
+      BOOST_REQUIRE_EQUAL(v, expected);
+      ++expected;
+    }
+  }
+
+  BOOST_CHECK_EQUAL(next, expected);
+  BOOST_CHECK_EQUAL(spsc_alive, 0);
+}
+
+BOOST_AUTO_TEST_CASE(SpscRingWrapAroundSmallAlignment) {
+  int_ring_t ring(64);
+
+  int next = 0;
+  int expected = 0;
+  bool ordered = true;
+
+  for(int round = 0; round < 100; ++round) {
+    // with 12- and 20-byte records in this pattern, the ring wraps with only 4 bytes left at its end
+    while(next % 7 == 0 ? ring.try_emplace<spsc_int_three>(spsc_int_three { { next }, 0, 0 })
+                        : ring.try_emplace<spsc_int_one  >(spsc_int_one   { { next } })) {
+      ++next;
+    }
+
+    ring.consume([&](spsc_int_base &obj) {
+        ordered = ordered && obj.x == expected;
+        ++expected;
+      });
+  }
+
+  BOOST_CHECK(ordered);
+  BOOST_CHECK_EQUAL(next, expected);
+  BOOST_CHECK(next > 100);
+}
+
+BOOST_AUTO_TEST_CASE(SpscRingLargeRecordAfterWrap) {
+  word_ring_t ring(128);
+
+  // head in the middle of the buffer, nothing queued
+  for(int i = 0; i < 4; ++i) {
+    BOOST_REQUIRE(ring.try_emplace<spsc_word_one>());
+  }
+
+  BOOST_CHECK_EQUAL(ring.consume([](spsc_word_base &) { }), 4u);
+  BOOST_REQUIRE    (ring.empty());
+
+  // the padding up to the end of the buffer and the record fit into an empty ring
+  BOOST_CHECK_EQUAL(ring.try_emplace<spsc_word_eight>(), true);
+  BOOST_CHECK_EQUAL(ring.consume([](spsc_word_base &) { }), 1u);
+
+  // and so they do wherever the positions are
+  bool fits = true;
+
+  for(std::size_t i = 0; i < ring.capacity() / 16; ++i) {
+    ring.try_emplace<spsc_word_one>();
+    ring.consume([](spsc_word_base &) { });
+
+    fits = fits && ring.try_emplace<spsc_word_eight>();
+    ring.consume([](spsc_word_base &) { });
+  }
+
+  BOOST_CHECK(fits);
+}
+
+BOOST_AUTO_TEST_CASE(SpscRingMaxCount) {
+  ring_t ring(1024);
+
+  for(long i = 0; i < 5; ++i) {
+    ring.try_emplace<spsc_small>(i);
+  }
+
+  BOOST_CHECK_EQUAL(ring.consume([](spsc_base &) { }, 2), 2u);
+  BOOST_CHECK((drain(ring) == std::vector<long>{ 2, 3, 4 }));
+}
+
+BOOST_AUTO_TEST_CASE(SpscRingThrowingConsumer) {
+  ring_t ring(1024);
+
+  for(long i = 0; i < 3; ++i) {
+    ring.try_emplace<spsc_small>(i);
+  }
+
+  BOOST_CHECK_THROW(ring.consume([](spsc_base &obj) {
+        if(obj.val() == 1) {
+          throw std::runtime_error("consumer");
+        }
+      }), std::runtime_error);
+
+  BOOST_CHECK_EQUAL(spsc_alive, 1);
+  BOOST_CHECK((drain(ring) == std::vector<long>{ 2 }));
+}
+
+BOOST_AUTO_TEST_CASE(SpscRingConcurrent) {
+  constexpr long count = 100000;
+
+  ring_t ring(4096);
+  long sum = 0;
+  long received = 0;
+  bool ordered = true;
+
+  std::thread producer([&] {
+      for(long i = 0; i < count; ++i) {
+        while(!(i % 7 == 0 ? ring.try_emplace<spsc_large>(i) : ring.try_emplace<spsc_small>(i))) {
+          std::this_thread::yield();
+        }
+      }
+    });
+
+  while(received < count) {
+    ring.consume([&](spsc_base &obj) {
+        ordered = ordered && obj.val() == received;
+        sum += obj.val();
+        ++received;
+      });
+  }
+
+  producer.join();
+
+  BOOST_CHECK(ordered);
+  BOOST_CHECK_EQUAL(sum, count * (count - 1) / 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
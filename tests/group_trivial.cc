@@ -0,0 +1,180 @@
+#include <boost/test/unit_test.hpp>
+#include <inplace/factory.hh>
+
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace {
+  enum {
+    QUOTE,
+    TRADE,
+    STATUS
+  };
+
+  struct trivial_base {
+    int kind;
+  };
+
+  struct trivial_quote : trivial_base {
+    trivial_quote(double bid, double ask) : trivial_base{QUOTE}, bid(bid), ask(ask) { }
+
+    double bid;
+    double ask;
+  };
+
+  struct trivial_trade : trivial_base {
+    trivial_trade(double px, int qty) : trivial_base{TRADE}, px(px), qty(qty) { }
+
+    double px;
+    int    qty;
+  };
+
+  struct filler { char padding[24]; };
+
+  // base_type is not the first base class, so the factory has to remember the offset.
+  struct trivial_status : filler, trivial_base {
+    trivial_status(int code) : filler{}, trivial_base{STATUS}, code(code) { }
+
+    int code;
+  };
+
+  typedef inplace::factory<trivial_base,
+                           trivial_quote,
+                           trivial_trade,
+                           trivial_status> factory_t;
+
+  // Trivially copyable, but not assignable.
+  struct trivial_const : trivial_base {
+    trivial_const(int id) : trivial_base{STATUS}, id(id) { }
+
+    int const id;
+  };
+
+  typedef inplace::factory<trivial_base, trivial_quote, trivial_const> const_factory_t;
+}
+
+BOOST_AUTO_TEST_SUITE(trivial_suite)
+
+BOOST_AUTO_TEST_CASE(TrivialProperties) {
+  BOOST_CHECK(std::is_trivially_copyable         <factory_t>::value);
+  BOOST_CHECK(std::is_trivially_copy_constructible<factory_t>::value);
+  BOOST_CHECK(std::is_trivially_move_constructible<factory_t>::value);
+  BOOST_CHECK(std::is_trivially_copy_assignable   <factory_t>::value);
+  BOOST_CHECK(std::is_trivially_move_assignable   <factory_t>::value);
+  BOOST_CHECK(std::is_trivially_destructible      <factory_t>::value);
+}
+
+BOOST_AUTO_TEST_CASE(TrivialConstruct) {
+  factory_t fct;
+
+  BOOST_CHECK(!fct);
+  BOOST_CHECK(fct.get_ptr() == nullptr);
+
+  fct.construct<trivial_quote>(1.5, 2.5);
+
+  BOOST_REQUIRE(fct);
+  BOOST_CHECK_EQUAL(fct->kind, QUOTE);
+
+  fct.construct<trivial_status>(42);
+
+  BOOST_REQUIRE(fct);
+  BOOST_CHECK_EQUAL(fct->kind, STATUS);
+  BOOST_CHECK_EQUAL(fct.visit([](auto &obj) { return static_cast<trivial_base const *>(&obj); }), fct.get_ptr());
+
+  fct.clear();
+
+  BOOST_CHECK(!fct);
+  BOOST_CHECK(fct.get_ptr() == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(TrivialCopy) {
+  factory_t fct;
+  fct.construct<trivial_status>(42);
+
+  factory_t fct2(fct);
+
+  BOOST_REQUIRE(fct2);
+  BOOST_CHECK_EQUAL(fct2->kind, STATUS);
+  BOOST_CHECK(fct2.get_ptr() != fct.get_ptr());
+  BOOST_CHECK_EQUAL(fct2.visit([](auto &obj) { return static_cast<trivial_base const *>(&obj); }), fct2.get_ptr());
+
+  fct.construct<trivial_trade>(99.5, 100);
+  fct2 = fct;
+
+  BOOST_REQUIRE(fct2);
+  BOOST_CHECK_EQUAL(fct2->kind, TRADE);
+  BOOST_CHECK_EQUAL(static_cast<trivial_trade &>(*fct2).qty, 100);
+}
+
+BOOST_AUTO_TEST_CASE(TrivialMove) {
+  factory_t fct;
+  fct.construct<trivial_quote>(1.5, 2.5);
+
+  factory_t fct2(std::move(fct));
+
+  BOOST_REQUIRE(fct2);
+  BOOST_CHECK_EQUAL(fct2->kind, QUOTE);
+  BOOST_CHECK_EQUAL(static_cast<trivial_quote &>(*fct2).ask, 2.5);
+
+  factory_t fct3;
+  fct3 = std::move(fct2);
+
+  BOOST_REQUIRE(fct3);
+  BOOST_CHECK_EQUAL(fct3->kind, QUOTE);
+}
+
+BOOST_AUTO_TEST_CASE(TrivialConstMember) {
+  BOOST_CHECK(std::is_copy_assignable_v<const_factory_t>);
+  BOOST_CHECK(std::is_move_assignable_v<const_factory_t>);
+  BOOST_CHECK(std::is_trivially_copy_constructible_v<const_factory_t>);
+
+  const_factory_t fct;
+  fct.construct<trivial_const>(7);
+
+  const_factory_t fct2;
+  fct2.construct<trivial_quote>(1.5, 2.5);
+  fct2 = fct;
+
+  BOOST_REQUIRE(fct2);
+  BOOST_CHECK_EQUAL(fct2.get_if<trivial_const>()->id, 7);
+
+  const_factory_t fct3;
+  fct3 = std::move(fct2);
+
+  BOOST_REQUIRE(fct3);
+  BOOST_CHECK_EQUAL(fct3.get_if<trivial_const>()->id, 7);
+
+  fct3 = const_factory_t();
+  BOOST_CHECK(!fct3);
+}
+
+BOOST_AUTO_TEST_CASE(TrivialMemcpy) {
+  factory_t fct;
+  fct.construct<trivial_status>(42);
+
+  factory_t fct2;
+  std::memcpy(static_cast<void *>(&fct2), &fct, sizeof(factory_t));
+
+  BOOST_REQUIRE(fct2);
+  BOOST_CHECK_EQUAL(fct2->kind, STATUS);
+  BOOST_CHECK_EQUAL(fct2.visit([](auto &obj) { return static_cast<trivial_base const *>(&obj); }), fct2.get_ptr());
+}
+
+BOOST_AUTO_TEST_CASE(TrivialVector) {
+  std::vector<factory_t> v(100);
+
+  for(std::size_t i = 0; i < v.size(); ++i) {
+    v[i].construct<trivial_status>(static_cast<int>(i));
+  }
+
+  v.resize(1000);
+
+  for(std::size_t i = 0; i < 100; ++i) {
+    BOOST_REQUIRE(v[i]);
+    BOOST_CHECK_EQUAL(v[i]->kind, STATUS);
+    BOOST_CHECK_EQUAL(static_cast<trivial_status &>(*v[i]).code, static_cast<int>(i));
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,177 @@
+#include <boost/test/unit_test.hpp>
+#include <inplace/factory.hh>
+
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+namespace {
+  struct visit_base {
+    virtual ~visit_base() { }
+    virtual int val() const = 0;
+  };
+
+  struct visit_small final : visit_base {
+    int val() const override { return 1; }
+  };
+
+  struct visit_x final : visit_base {
+    visit_x(int x) : x_(x) { }
+    int val() const override { return x_; }
+
+    int x_;
+  };
+
+  struct filler { int padding[10]; };
+
+  struct visit_back final : filler, visit_base {
+    int val() const override { return 3; }
+  };
+
+  template<int i>
+  struct visit_many final : visit_base {
+    int val() const override { return i; }
+  };
+
+  typedef inplace::factory<visit_base,
+                           visit_small,
+                           visit_x,
+                           visit_back> factory_t;
+
+  // more types than dispatch_chain_limit, so that the jump table is used.
+  typedef inplace::factory<visit_base,
+                           visit_many< 0>, visit_many< 1>, visit_many< 2>, visit_many< 3>,
+                           visit_many< 4>, visit_many< 5>, visit_many< 6>, visit_many< 7>,
+                           visit_many< 8>, visit_many< 9>, visit_many<10>, visit_many<11>> many_factory_t;
+
+  struct type_name {
+    std::string operator()(visit_small const &) const { return "small"; }
+    std::string operator()(visit_x     const &) const { return "x"    ; }
+    std::string operator()(visit_back  const &) const { return "back" ; }
+  };
+}
+
+BOOST_AUTO_TEST_SUITE(visit_suite)
+
+BOOST_AUTO_TEST_CASE(VisitConcreteType) {
+  factory_t fct;
+
+  fct.construct<visit_small>();
+  BOOST_CHECK_EQUAL(fct.visit(type_name()), "small");
+
+  fct.construct<visit_x>(10);
+  BOOST_CHECK_EQUAL(fct.visit(type_name()), "x");
+
+  fct.construct<visit_back>();
+  BOOST_CHECK_EQUAL(fct.visit(type_name()), "back");
+}
+
+BOOST_AUTO_TEST_CASE(VisitReturnsResult) {
+  factory_t fct;
+
+  fct.construct<visit_x>(10);
+  BOOST_CHECK_EQUAL(fct.visit([](auto &obj) { return obj.val(); }), 10);
+
+  fct.construct<visit_back>();
+  BOOST_CHECK_EQUAL(fct.visit([](auto &obj) { return obj.val(); }), 3);
+}
+
+BOOST_AUTO_TEST_CASE(VisitModifies) {
+  factory_t fct;
+
+  fct.construct<visit_x>(10);
+  fct.visit([](auto &obj) {
+      if constexpr(std::is_same_v<std::remove_cvref_t<decltype(obj)>, visit_x>) {
+        obj.x_ = 20;
+      }
+    });
+
+  BOOST_CHECK_EQUAL(fct->val(), 20);
+}
+
+BOOST_AUTO_TEST_CASE(VisitConst) {
+  factory_t fct;
+  fct.construct<visit_back>();
+
+  factory_t const &cfct = fct;
+
+  cfct.visit([&](auto &obj) {
+      BOOST_CHECK(std::is_const_v<std::remove_reference_t<decltype(obj)>>);
+      BOOST_CHECK_EQUAL(static_cast<visit_base const *>(&obj), fct.get_ptr());
+    });
+}
+
+BOOST_AUTO_TEST_CASE(VisitExplicitResult) {
+  factory_t fct;
+  fct.construct<visit_small>();
+
+  // different result types per alternative are fine with an explicit result type.
+  struct mixed_result {
+    int    operator()(visit_small const &) const { return 1  ; }
+    double operator()(visit_x     const &) const { return 2.5; }
+    long   operator()(visit_back  const &) const { return 3  ; }
+  };
+
+  BOOST_CHECK_EQUAL(fct.visit<double>(mixed_result()), 1.0);
+
+  fct.construct<visit_x>(0);
+  BOOST_CHECK_EQUAL(fct.visit<double>(mixed_result()), 2.5);
+
+  int calls = 0;
+  fct.visit<void>([&](auto &) { return ++calls; });
+  BOOST_CHECK_EQUAL(calls, 1);
+}
+
+BOOST_AUTO_TEST_CASE(VisitJumpTable) {
+  many_factory_t fct;
+
+  fct.construct<visit_many<0>>();
+  BOOST_CHECK_EQUAL(fct.visit([](auto &obj) { return obj.val(); }), 0);
+
+  fct.construct<visit_many<7>>();
+  BOOST_CHECK_EQUAL(fct.visit([](auto &obj) { return obj.val(); }), 7);
+
+  fct.construct<visit_many<11>>();
+  BOOST_CHECK_EQUAL(fct.visit([](auto &obj) { return obj.val(); }), 11);
+}
+
+BOOST_AUTO_TEST_CASE(VisitConstructByIndex) {
+  factory_t fct;
+
+  fct.construct_by_index(factory_t::index_of<visit_x>, 5);
+  BOOST_CHECK_EQUAL(fct.index(), 1u);
+  BOOST_CHECK_EQUAL(fct->val(), 5);
+
+  fct.construct_by_index(factory_t::index_of<visit_back>);
+  BOOST_CHECK_EQUAL(fct.visit(type_name()), "back");
+
+  // round trip through index()
+  factory_t copy;
+  copy.construct_by_index(fct.index());
+  BOOST_CHECK_EQUAL(copy.visit(type_name()), "back");
+}
+
+BOOST_AUTO_TEST_CASE(VisitConstructByIndexErrors) {
+  factory_t fct;
+  fct.construct<visit_x>(5);
+
+  // visit_small takes no int, visit_x needs one
+  BOOST_CHECK_THROW(fct.construct_by_index(factory_t::index_of<visit_small>, 1), inplace::bad_type_index);
+  BOOST_CHECK_THROW(fct.construct_by_index(factory_t::index_of<visit_x    >   ), inplace::bad_type_index);
+  BOOST_CHECK_THROW(fct.construct_by_index(factory_t::type_count              ), std::out_of_range);
+  BOOST_CHECK_THROW(fct.construct_by_index(factory_t::npos                    ), std::out_of_range);
+
+  BOOST_CHECK_EQUAL(fct->val(), 5);
+}
+
+BOOST_AUTO_TEST_CASE(VisitConstructByIndexJumpTable) {
+  many_factory_t fct;
+
+  for(std::size_t i = 0; i < many_factory_t::type_count; ++i) {
+    fct.construct_by_index(i);
+    BOOST_CHECK_EQUAL(fct.index(), i);
+    BOOST_CHECK_EQUAL(fct->val(), static_cast<int>(i));
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()